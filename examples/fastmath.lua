@@ -0,0 +1,70 @@
+#!/usr/bin/env lua
+-- MoonGLMATH example: fastmath.lua
+--
+-- Compares the approximated functions (fast_rsqrt, fast_normalize, nlerp, fast_slerp)
+-- with the exact ones, over random inputs, and checks the documented error bounds.
+
+local glmath = require("moonglmath")
+local vec3, quat = glmath.vec3, glmath.quat
+local abs, max, random = math.abs, math.max, math.random
+
+local function randquat()
+   return quat(random()-.5, random()-.5, random()-.5, random()-.5):normalize()
+end
+
+local N = 20000
+
+-- fast_rsqrt: relative error
+local err = 0
+for i = 1, N do
+   local x = 10^(random()*20-10)
+   err = max(err, abs(glmath.fast_rsqrt(x)*math.sqrt(x) - 1))
+end
+print("fast_rsqrt max relative error", err)
+assert(err < 5e-6)
+
+-- fast_normalize: relative error per element
+err = 0
+for i = 1, N do
+   local v = vec3(random()-.5, random()-.5, random()-.5)*10^(random()*6-3)
+   local a, b = v:normalize(), v:fast_normalize()
+   for j = 1, 3 do err = max(err, abs(a[j]-b[j])) end
+end
+print("fast_normalize max error", err)
+assert(err < 5e-6)
+
+-- fast_slerp: absolute error per element
+err = 0
+for i = 1, N do
+   local q, p, k = randquat(), randquat(), random()
+   local a, b = glmath.slerp(q, p, k), glmath.fast_slerp(q, p, k)
+   for j = 1, 4 do err = max(err, abs(a[j]-b[j])) end
+end
+print("fast_slerp max error", err)
+assert(err < 3e-5)
+
+-- nlerp: rotation angle error, for rotations differing by up to 20 degrees
+err = 0
+for i = 1, N do
+   local q = randquat()
+   local axis = vec3(random()-.5, random()-.5, random()-.5):normalize()
+   local p = q*quat(axis, math.rad(20)*random())
+   local k = random()
+   local r = glmath.slerp(q, p, k)*glmath.nlerp(q, p, k):conj()
+   err = max(err, 2*math.atan(math.sqrt(r[2]^2+r[3]^2+r[4]^2), abs(r[1])))
+end
+print("nlerp max angle error (20 deg)", err)
+assert(err < 2e-4)
+
+-- timings
+local q, p = randquat(), randquat()
+local t = glmath.now()
+for i = 1, N do glmath.slerp(q, p, i/N) end
+print("slerp", glmath.since(t))
+t = glmath.now()
+for i = 1, N do glmath.fast_slerp(q, p, i/N) end
+print("fast_slerp", glmath.since(t))
+t = glmath.now()
+for i = 1, N do glmath.nlerp(q, p, i/N) end
+print("nlerp", glmath.since(t))
+
@@ -0,0 +1,165 @@
+-- The MIT License (MIT)
+--
+-- Copyright (c) 2020 Stefano Trettel
+--
+-- Software repository: MoonGLMATH, https://github.com/stetre/moonglmath
+--
+-- Permission is hereby granted, free of charge, to any person obtaining a copy
+-- of this software and associated documentation files (the "Software"), to deal
+-- in the Software without restriction, including without limitation the rights
+-- to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+-- copies of the Software, and to permit persons to whom the Software is
+-- furnished to do so, subject to the following conditions:
+--
+-- The above copyright notice and this permission notice shall be included in all
+-- copies or substantial portions of the Software.
+--
+-- THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+-- IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+-- FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+-- AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+-- LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+-- OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+-- SOFTWARE.
+--
+-- LuaJIT FFI bindings for the flat C ABI of MoonGLMATH (LuaJIT only).
+--
+-- local gffi = require("moonglmath.ffi")
+-- local p = gffi.doubles(hostmem)                     -- double* to the hostmem's memory
+-- gffi.C.moonglmath_batch_mat4_transform(p, m, p, n)  -- no Lua C API call, so traces stay compiled
+--
+-- The declarations mirror those in moonglmath.h (the functions that use the Lua API
+-- or complex numbers are excluded). Vectors, quaternions and dual quaternions are
+-- arrays of 4, 4 and 8 doubles; matrices are 4x4 arrays of doubles (only the upper-left
+-- rows x columns part is used); batch functions operate on packed arrays (see batch.c).
+
+local ffi = require("ffi")
+
+ffi.cdef[[
+typedef double moonglmath_vec_t[4];
+typedef double moonglmath_mat_t[4][4];
+typedef double moonglmath_quat_t[4];
+typedef double moonglmath_dualquat_t[8];
+
+void moonglmath_vec_unm(moonglmath_vec_t dst, moonglmath_vec_t v, size_t n);
+void moonglmath_vec_add(moonglmath_vec_t dst, moonglmath_vec_t v1, moonglmath_vec_t v2, size_t n);
+void moonglmath_vec_sub(moonglmath_vec_t dst, moonglmath_vec_t v1, moonglmath_vec_t v2, size_t n);
+double moonglmath_vec_norm(moonglmath_vec_t v, size_t n);
+double moonglmath_vec_norm2(moonglmath_vec_t v, size_t n);
+void moonglmath_vec_normalize(moonglmath_vec_t v, size_t n);
+void moonglmath_vec_fast_normalize(moonglmath_vec_t v, size_t n);
+void moonglmath_vec_div(moonglmath_vec_t dst, moonglmath_vec_t v, double s, size_t n);
+double moonglmath_vec_dot(moonglmath_vec_t v1, moonglmath_vec_t v2, size_t n);
+void moonglmath_vec_vxs(moonglmath_vec_t dst, moonglmath_vec_t v, double s, size_t n);
+void moonglmath_vec_vxv(moonglmath_mat_t dst, moonglmath_vec_t v1, moonglmath_vec_t v2, size_t n);
+void moonglmath_vec_cross(moonglmath_vec_t dst, moonglmath_vec_t v1, moonglmath_vec_t v2);
+void moonglmath_vec_clamp(moonglmath_vec_t dst, moonglmath_vec_t v, moonglmath_vec_t minv, moonglmath_vec_t maxv, size_t n);
+void moonglmath_vec_mix(moonglmath_vec_t dst, moonglmath_vec_t v1, moonglmath_vec_t v2, size_t n, double k);
+void moonglmath_vec_step(moonglmath_vec_t dst, moonglmath_vec_t v, moonglmath_vec_t edge, size_t n);
+void moonglmath_vec_smoothstep(moonglmath_vec_t dst, moonglmath_vec_t v, moonglmath_vec_t edge0, moonglmath_vec_t edge1, size_t n);
+void moonglmath_vec_fade(moonglmath_vec_t dst, moonglmath_vec_t v, moonglmath_vec_t edge0, moonglmath_vec_t edge1, size_t n);
+void moonglmath_mat_unm(moonglmath_mat_t dst, moonglmath_mat_t m, size_t nr, size_t nc);
+void moonglmath_mat_transpose(moonglmath_mat_t dst, moonglmath_mat_t m, size_t nr, size_t nc);
+void moonglmath_mat_add(moonglmath_mat_t dst, moonglmath_mat_t m1, moonglmath_mat_t m2, size_t nr, size_t nc);
+void moonglmath_mat_sub(moonglmath_mat_t dst, moonglmath_mat_t m1, moonglmath_mat_t m2, size_t nr, size_t nc);
+void moonglmath_mat_div(moonglmath_mat_t dst, moonglmath_mat_t m, double s, size_t nr, size_t nc);
+void moonglmath_mat_mul(moonglmath_mat_t dst, moonglmath_mat_t m1, moonglmath_mat_t m2, size_t nr1, size_t nc1, size_t nc2);
+void moonglmath_mat_mulby(moonglmath_mat_t m1, moonglmath_mat_t m2, size_t nr1, size_t nc1, size_t nc2);
+void moonglmath_mat_mxs(moonglmath_mat_t dst, moonglmath_mat_t m, double s, size_t nr, size_t nc);
+void moonglmath_mat_mxv(moonglmath_vec_t dst, moonglmath_mat_t m, moonglmath_vec_t v, size_t nr, size_t nc);
+void moonglmath_mat_vxm(moonglmath_vec_t dst, moonglmath_vec_t v, moonglmath_mat_t m, size_t nr, size_t nc);
+double moonglmath_mat_det2(moonglmath_mat_t m);
+double moonglmath_mat_det3(moonglmath_mat_t m);
+double moonglmath_mat_det4(moonglmath_mat_t m);
+void moonglmath_mat_adj(moonglmath_mat_t dst, moonglmath_mat_t m, size_t n);
+int moonglmath_mat_inv(moonglmath_mat_t dst, moonglmath_mat_t m, size_t n);
+int moonglmath_mat_isaffine(moonglmath_mat_t m);
+int moonglmath_mat_affine_inv(moonglmath_mat_t dst, moonglmath_mat_t m);
+void moonglmath_mat_rigid_inv(moonglmath_mat_t dst, moonglmath_mat_t m);
+void moonglmath_mat_affine_mul(moonglmath_mat_t dst, moonglmath_mat_t m1, moonglmath_mat_t m2);
+int moonglmath_mat_clamp(moonglmath_mat_t dst, moonglmath_mat_t m, moonglmath_mat_t minm, moonglmath_mat_t maxm, size_t nr, size_t nc);
+int moonglmath_mat_mix(moonglmath_mat_t dst, moonglmath_mat_t m1, moonglmath_mat_t m2, size_t nr, size_t nc, double k);
+int moonglmath_mat_step(moonglmath_mat_t dst, moonglmath_mat_t m, moonglmath_mat_t edge, size_t nr, size_t nc);
+int moonglmath_mat_smoothstep(moonglmath_mat_t dst, moonglmath_mat_t m, moonglmath_mat_t edge0, moonglmath_mat_t edge1, size_t nr, size_t nc);
+int moonglmath_mat_fade(moonglmath_mat_t dst, moonglmath_mat_t m, moonglmath_mat_t edge0, moonglmath_mat_t edge1, size_t nr, size_t nc);
+void moonglmath_quat_unm(moonglmath_quat_t dst, moonglmath_quat_t q);
+void moonglmath_quat_add(moonglmath_quat_t dst, moonglmath_quat_t q1, moonglmath_quat_t q2);
+void moonglmath_quat_sub(moonglmath_quat_t dst, moonglmath_quat_t q1, moonglmath_quat_t q2);
+double moonglmath_quat_norm(moonglmath_quat_t q);
+double moonglmath_quat_norm2(moonglmath_quat_t q);
+void moonglmath_quat_normalize(moonglmath_quat_t q);
+void moonglmath_quat_fast_normalize(moonglmath_quat_t q);
+void moonglmath_quat_conj(moonglmath_quat_t dst, moonglmath_quat_t q); 
+void moonglmath_quat_inv(moonglmath_quat_t dst, moonglmath_quat_t q);
+void moonglmath_quat_div(moonglmath_quat_t dst, moonglmath_quat_t q, double s);
+void moonglmath_quat_mul(moonglmath_quat_t dst, moonglmath_quat_t q, moonglmath_quat_t p);
+void moonglmath_quat_qxs(moonglmath_quat_t dst, moonglmath_quat_t q, double s);
+void moonglmath_quat_mix(moonglmath_quat_t dst, moonglmath_quat_t q, moonglmath_quat_t p, double t);
+void moonglmath_quat_slerp(moonglmath_quat_t dst, moonglmath_quat_t q, moonglmath_quat_t p, double t);
+void moonglmath_quat_nlerp(moonglmath_quat_t dst, moonglmath_quat_t q, moonglmath_quat_t p, double t);
+void moonglmath_quat_fast_slerp(moonglmath_quat_t dst, moonglmath_quat_t q, moonglmath_quat_t p, double t);
+void moonglmath_quat_frommat(moonglmath_quat_t q, moonglmath_mat_t m);
+void moonglmath_dualquat_from_rt(moonglmath_dualquat_t dq, moonglmath_quat_t r, moonglmath_vec_t t);
+void moonglmath_dualquat_to_rt(moonglmath_quat_t r, moonglmath_vec_t t, moonglmath_dualquat_t dq);
+void moonglmath_dualquat_mul(moonglmath_dualquat_t dst, moonglmath_dualquat_t a, moonglmath_dualquat_t b);
+void moonglmath_dualquat_conj(moonglmath_dualquat_t dst, moonglmath_dualquat_t dq);
+void moonglmath_dualquat_normalize(moonglmath_dualquat_t dq);
+void moonglmath_dualquat_sclerp(moonglmath_dualquat_t dst, moonglmath_dualquat_t a, moonglmath_dualquat_t b, double t);
+void moonglmath_dualquat_transform(moonglmath_vec_t dst, moonglmath_dualquat_t dq, moonglmath_vec_t p);
+double moonglmath_clamp(double x, double minval, double maxval);
+double moonglmath_mix(double x, double y, double k);
+double moonglmath_step(double x, double edge);
+double moonglmath_smoothstep(double x, double edge0, double edge1);
+double moonglmath_fade(double x, double edge0, double edge1);
+double moonglmath_fast_rsqrt(double x);
+double moonglmath_now(void);
+void moonglmath_translate(moonglmath_mat_t m, double x, double y, double z);
+void moonglmath_scale(moonglmath_mat_t m, double x, double y, double z);
+void moonglmath_rotate_x(moonglmath_mat_t m, double rad);
+void moonglmath_rotate_y(moonglmath_mat_t m, double rad);
+void moonglmath_rotate_z(moonglmath_mat_t m, double rad);
+void moonglmath_compose_trs(moonglmath_mat_t m, moonglmath_vec_t t, moonglmath_quat_t q, moonglmath_vec_t s);
+void moonglmath_decompose_trs(moonglmath_vec_t t, moonglmath_quat_t q, moonglmath_vec_t s, moonglmath_mat_t m);
+int moonglmath_look_at(moonglmath_mat_t dst, moonglmath_vec_t eye, moonglmath_vec_t at, moonglmath_vec_t up);
+int moonglmath_ortho(moonglmath_mat_t dst, double l, double r, double b, double t, double n, double f);
+int moonglmath_frustum(moonglmath_mat_t dst, double l, double r, double b, double t, double n, double f);
+int moonglmath_perspective(moonglmath_mat_t dst, double fovy, double aspect, double n, double f);
+void moonglmath_batch_mat4_mul(double *dst, const double *a, const double *b, size_t count);
+void moonglmath_batch_mat4_premul(double *dst, const double *m, const double *b, size_t count);
+void moonglmath_batch_mat4_transform(double *dst, const double *m, const double *src, size_t count);
+void moonglmath_batch_mat4_transform_points(double *dst, const double *m, const double *src, size_t count);
+void moonglmath_batch_mat4_transform_dirs(double *dst, const double *m, const double *src, size_t count);
+void moonglmath_batch_quat_mul(double *dst, const double *a, const double *b, size_t count);
+void moonglmath_batch_quat_rotate(double *dst, const double *q, const double *src, size_t count);
+void moonglmath_batch_vec3_normalize(double *dst, const double *src, size_t count);
+void moonglmath_batch_vec3_dot(double *dst, const double *a, const double *b, size_t count);
+void moonglmath_batch_vec3_cross(double *dst, const double *a, const double *b, size_t count);
+void moonglmath_batch_mat4_mulf(float *dst, const float *a, const float *b, size_t count);
+void moonglmath_batch_mat4_premulf(float *dst, const float *m, const float *b, size_t count);
+void moonglmath_batch_mat4_transformf(float *dst, const float *m, const float *src, size_t count);
+void moonglmath_batch_mat4_transform_pointsf(float *dst, const float *m, const float *src, size_t count);
+void moonglmath_batch_mat4_transform_dirsf(float *dst, const float *m, const float *src, size_t count);
+void moonglmath_batch_quat_mulf(float *dst, const float *a, const float *b, size_t count);
+void moonglmath_batch_quat_rotatef(float *dst, const float *q, const float *src, size_t count);
+void moonglmath_batch_vec3_normalizef(float *dst, const float *src, size_t count);
+void moonglmath_batch_vec3_dotf(float *dst, const float *a, const float *b, size_t count);
+void moonglmath_batch_vec3_crossf(float *dst, const float *a, const float *b, size_t count);
+]]
+
+local M = {}
+
+-- The C library (the same shared object loaded by require("moonglmath")).
+M.C = ffi.load(assert(package.searchpath("moonglmath", package.cpath), "moonglmath not found"))
+
+-- Pointers to the memory of a hostmem, optionally at the given offset (in bytes).
+M.ptr = function(hostmem, ctype, offset) return ffi.cast(ctype, hostmem:ptr(offset)) end
+M.doubles = function(hostmem, offset) return ffi.cast("double*", hostmem:ptr(offset)) end
+M.floats = function(hostmem, offset) return ffi.cast("float*", hostmem:ptr(offset)) end
+
+-- Constructors for the fixed-size types expected by the kernels.
+M.vec = ffi.typeof("moonglmath_vec_t")
+M.mat = ffi.typeof("moonglmath_mat_t")
+M.quat = ffi.typeof("moonglmath_quat_t")
+M.dualquat = ffi.typeof("moonglmath_dualquat_t")
+
+return M
@@ -83,14 +83,20 @@ mt.__newindex = function(self, key, val)
    end
 end
 
-moonglmath.tomat2 = function(t) setmetatable(t, mt) t.rows=2 t.columns=2 return t end
-moonglmath.tomat3 = function(t) setmetatable(t, mt) t.rows=3 t.columns=3 return t end
-moonglmath.tomat4 = function(t) setmetatable(t, mt) t.rows=4 t.columns=4 return t end
-moonglmath.tomat2x3 = function(t) setmetatable(t, mt) t.rows=2 t.columns=3 return t end
-moonglmath.tomat3x2 = function(t) setmetatable(t, mt) t.rows=3 t.columns=2 return t end
-moonglmath.tomat2x4 = function(t) setmetatable(t, mt) t.rows=2 t.columns=4 return t end
-moonglmath.tomat4x2 = function(t) setmetatable(t, mt) t.rows=4 t.columns=2 return t end
-moonglmath.tomat3x4 = function(t) setmetatable(t, mt) t.rows=3 t.columns=4 return t end
-moonglmath.tomat4x3 = function(t) setmetatable(t, mt) t.rows=4 t.columns=3 return t end
+-- each matrix shape has its own metatable (see mat.c), that forwards to mt
+local function tomat(name, rows, columns)
+   local mt = debug.getmetatable(moonglmath[name]())
+   moonglmath["to"..name] = function(t) setmetatable(t, mt) t.rows=rows t.columns=columns return t end
+end
+
+tomat("mat2", 2, 2)
+tomat("mat3", 3, 3)
+tomat("mat4", 4, 4)
+tomat("mat2x3", 2, 3)
+tomat("mat3x2", 3, 2)
+tomat("mat2x4", 2, 4)
+tomat("mat4x2", 4, 2)
+tomat("mat3x4", 3, 4)
+tomat("mat4x3", 4, 3)
 
 end
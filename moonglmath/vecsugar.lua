@@ -25,67 +25,21 @@
 
 
 -- 
--- Adds named-components access to MoonGLMATH vectors
--- ( v.x becomes an alias for v[1], v.y becomes an alias for v[2], and so on).
---
---
---
+-- Constructors for MoonGLMATH vectors from existing tables.
+-- (Named components and swizzles, i.e. v.x, v.rgb, etc, are implemented in C, see vec.c).
 --
 
---local glmath = require("moonglmath")
---local mt = getmetatable(glmath.vec2())
 do
-local mt = getmetatable(moonglmath.vec2())
-local methods = mt.__index
-
-local rd = {} -- read functions
-local wr = {} -- write indices
-
--- position components
-rd.x = function(self) return self[1] end
-rd.y = function(self) return self[2] end
-rd.z = function(self) return self[3] end
-rd.w = function(self) return self[4] end
-wr.x, wr.y, wr.z, wr.w = 1,2,3,4
-
--- color components
-rd.r = function(self) return self[1] end
-rd.g = function(self) return self[2] end
-rd.b = function(self) return self[3] end
-rd.a = function(self) return self[4] end
-wr.r, wr.g, wr.b, wr.a = 1,2,3,4
-
--- texture components
-rd.s = function(self) return self[1] end
-rd.t = function(self) return self[2] end
-rd.p = function(self) return self[3] end
-rd.q = function(self) return self[4] end
-wr.s, wr.t, wr.p, wr.q = 1,2,3,4
-
-mt.__index = function(self, key) 
-   local f = rd[key]
-   if f then return f(self) end
-   return methods[key]
-end
-
-mt.__newindex = function(self, key, val)
-   if type(key) == "number" or key == "size" or key == "type" then
-      rawset(self, key, val)
-      return
-   end
-   local i = wr[key]
-   if i then 
-      rawset(self, i, val)
-   else
-      error("cannot write field '" .. key .."'", 2)
-   end
+-- each vector shape has its own metatable (see vec.c), hidden behind the generic one
+local function tovec(mt, size, type)
+   return function(t) setmetatable(t, mt) t.type=type t.size=size return t end
 end
 
-moonglmath.tovec2 = function(t) setmetatable(t, mt) t.type="column" t.size=2 return t end
-moonglmath.tovec3 = function(t) setmetatable(t, mt) t.type="column" t.size=3 return t end
-moonglmath.tovec4 = function(t) setmetatable(t, mt) t.type="column" t.size=4 return t end
-moonglmath.tovec2r = function(t) setmetatable(t, mt) t.type="row" t.size=2 return t end
-moonglmath.tovec3r = function(t) setmetatable(t, mt) t.type="row" t.size=3 return t end
-moonglmath.tovec4r = function(t) setmetatable(t, mt) t.type="row" t.size=4 return t end
+moonglmath.tovec2 = tovec(debug.getmetatable(moonglmath.vec2()), 2, "column")
+moonglmath.tovec3 = tovec(debug.getmetatable(moonglmath.vec3()), 3, "column")
+moonglmath.tovec4 = tovec(debug.getmetatable(moonglmath.vec4()), 4, "column")
+moonglmath.tovec2r = tovec(debug.getmetatable(moonglmath.vec2r()), 2, "row")
+moonglmath.tovec3r = tovec(debug.getmetatable(moonglmath.vec3r()), 3, "row")
+moonglmath.tovec4r = tovec(debug.getmetatable(moonglmath.vec4r()), 4, "row")
 
 end
@@ -0,0 +1,71 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Stefano Trettel
+ *
+ * Software repository: MoonGLMATH, https://github.com/stetre/moonglmath
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "internal.h"
+
+/* Native API table (see moonglmath.h) */
+static const moonglmath_api_t Api = {
+    MOONGLMATH_API_VERSION,
+    /* hostmem */
+    moonglmath_testhostmemptr,
+    moonglmath_checkhostmemptr,
+    moonglmath_checkhostmemarray,
+    /* values */
+    moonglmath_testvec,
+    moonglmath_pushvec,
+    moonglmath_testmat,
+    moonglmath_pushmat,
+    moonglmath_testquat,
+    moonglmath_pushquat,
+    /* batch operations (double) */
+    moonglmath_batch_mat4_mul,
+    moonglmath_batch_mat4_premul,
+    moonglmath_batch_mat4_transform,
+    moonglmath_batch_mat4_transform_points,
+    moonglmath_batch_mat4_transform_dirs,
+    moonglmath_batch_quat_mul,
+    moonglmath_batch_quat_rotate,
+    moonglmath_batch_vec3_normalize,
+    moonglmath_batch_vec3_dot,
+    moonglmath_batch_vec3_cross,
+    /* batch operations (float) */
+    moonglmath_batch_mat4_mulf,
+    moonglmath_batch_mat4_premulf,
+    moonglmath_batch_mat4_transformf,
+    moonglmath_batch_mat4_transform_pointsf,
+    moonglmath_batch_mat4_transform_dirsf,
+    moonglmath_batch_quat_mulf,
+    moonglmath_batch_quat_rotatef,
+    moonglmath_batch_vec3_normalizef,
+    moonglmath_batch_vec3_dotf,
+    moonglmath_batch_vec3_crossf,
+};
+
+void moonglmath_open_api(lua_State *L)
+    {
+    lua_pushlightuserdata(L, (void*)&Api);
+    lua_setfield(L, LUA_REGISTRYINDEX, MOONGLMATH_API_KEY);
+    }
+
@@ -0,0 +1,216 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Stefano Trettel
+ *
+ * Software repository: MoonGLMATH, https://github.com/stetre/moonglmath
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "internal.h"
+
+/* Flat C ABI for batch operations.
+ * These functions operate on plain contiguous arrays of doubles (or floats, for the
+ * variants with the 'f' suffix) and do not use the Lua API, so that they can be called
+ * directly from C code, or through LuaJIT's FFI on the memory of a hostmem (see
+ * moonglmath/ffi.lua). They are declared in moonglmath.h.
+ *
+ * Layouts:
+ * mat4 = 16 values in row-major order, quat = 4 values (w, x, y, z), vec3 = 3 values,
+ * vec4 = 4 values. The dst array may coincide with (but not partially overlap) a source.
+ * Computations are always carried out in double precision.
+ */
+
+/*------------------------------------------------------------------------------*
+ | Matrices                                                                     |
+ *------------------------------------------------------------------------------*/
+
+#define MAT4_MUL(T, S)                                                          \
+void moonglmath_batch_mat4_mul##S(T *dst, const T *a, const T *b, size_t count) \
+/* dst[i] = a[i] * b[i] */                                                      \
+    {                                                                           \
+    size_t n, i, j, k;                                                          \
+    double m[16], s;                                                            \
+    for(n = 0; n < count; n++, dst += 16, a += 16, b += 16)                     \
+        {                                                                       \
+        for(i = 0; i < 4; i++)                                                  \
+            for(j = 0; j < 4; j++)                                              \
+                {                                                               \
+                s = 0;                                                          \
+                for(k = 0; k < 4; k++)                                          \
+                    s += (double)a[i*4+k] * b[k*4+j];                           \
+                m[i*4+j] = s;                                                   \
+                }                                                               \
+        for(i = 0; i < 16; i++) dst[i] = m[i];                                  \
+        }                                                                       \
+    }
+
+#define MAT4_PREMUL(T, S)                                                       \
+void moonglmath_batch_mat4_premul##S(T *dst, const T *m, const T *b, size_t count) \
+/* dst[i] = m * b[i] */                                                         \
+    {                                                                           \
+    size_t n, i, j, k;                                                          \
+    double mm[16], r[16], s;                                                    \
+    for(i = 0; i < 16; i++) mm[i] = m[i];                                       \
+    for(n = 0; n < count; n++, dst += 16, b += 16)                              \
+        {                                                                       \
+        for(i = 0; i < 4; i++)                                                  \
+            for(j = 0; j < 4; j++)                                              \
+                {                                                               \
+                s = 0;                                                          \
+                for(k = 0; k < 4; k++)                                          \
+                    s += mm[i*4+k] * b[k*4+j];                                  \
+                r[i*4+j] = s;                                                   \
+                }                                                               \
+        for(i = 0; i < 16; i++) dst[i] = r[i];                                  \
+        }                                                                       \
+    }
+
+#define MAT4_TRANSFORM(T, S)                                                    \
+void moonglmath_batch_mat4_transform##S(T *dst, const T *m, const T *src, size_t count) \
+/* dst[i] = m * src[i], with src[i] and dst[i] vec4 */                          \
+    {                                                                           \
+    size_t n, i;                                                                \
+    double mm[16], x, y, z, w;                                                  \
+    for(i = 0; i < 16; i++) mm[i] = m[i];                                       \
+    for(n = 0; n < count; n++, dst += 4, src += 4)                              \
+        {                                                                       \
+        x = src[0]; y = src[1]; z = src[2]; w = src[3];                         \
+        for(i = 0; i < 4; i++)                                                  \
+            dst[i] = mm[i*4]*x + mm[i*4+1]*y + mm[i*4+2]*z + mm[i*4+3]*w;       \
+        }                                                                       \
+    }
+
+#define MAT4_TRANSFORM3(T, S, name, w)                                          \
+void moonglmath_batch_mat4_##name##S(T *dst, const T *m, const T *src, size_t count) \
+/* dst[i] = xyz of m * (src[i], w), with src[i] and dst[i] vec3 */              \
+    {                                                                           \
+    size_t n, i;                                                                \
+    double mm[16], x, y, z;                                                     \
+    for(i = 0; i < 16; i++) mm[i] = m[i];                                       \
+    for(n = 0; n < count; n++, dst += 3, src += 3)                              \
+        {                                                                       \
+        x = src[0]; y = src[1]; z = src[2];                                     \
+        for(i = 0; i < 3; i++)                                                  \
+            dst[i] = mm[i*4]*x + mm[i*4+1]*y + mm[i*4+2]*z + mm[i*4+3]*(w);     \
+        }                                                                       \
+    }
+
+/*------------------------------------------------------------------------------*
+ | Quaternions                                                                  |
+ *------------------------------------------------------------------------------*/
+
+#define QUAT_MUL(T, S)                                                          \
+void moonglmath_batch_quat_mul##S(T *dst, const T *a, const T *b, size_t count) \
+/* dst[i] = a[i] * b[i] */                                                      \
+    {                                                                           \
+    size_t n;                                                                   \
+    double aw, ax, ay, az, bw, bx, by, bz;                                      \
+    for(n = 0; n < count; n++, dst += 4, a += 4, b += 4)                        \
+        {                                                                       \
+        aw = a[0]; ax = a[1]; ay = a[2]; az = a[3];                             \
+        bw = b[0]; bx = b[1]; by = b[2]; bz = b[3];                             \
+        dst[0] = aw*bw - ax*bx - ay*by - az*bz;                                 \
+        dst[1] = aw*bx + ax*bw + ay*bz - az*by;                                 \
+        dst[2] = aw*by - ax*bz + ay*bw + az*bx;                                 \
+        dst[3] = aw*bz + ax*by - ay*bx + az*bw;                                 \
+        }                                                                       \
+    }
+
+#define QUAT_ROTATE(T, S)                                                       \
+void moonglmath_batch_quat_rotate##S(T *dst, const T *q, const T *src, size_t count) \
+/* dst[i] = q * src[i] * conj(q), with q a unit quaternion and src[i], dst[i] vec3 */ \
+    {                                                                           \
+    size_t n;                                                                   \
+    double w = q[0], x = q[1], y = q[2], z = q[3];                              \
+    double vx, vy, vz, tx, ty, tz;                                              \
+    for(n = 0; n < count; n++, dst += 3, src += 3)                              \
+        {                                                                       \
+        vx = src[0]; vy = src[1]; vz = src[2];                                  \
+        /* t = 2 (q.xyz x v), v' = v + w t + q.xyz x t */                       \
+        tx = 2*(y*vz - z*vy); ty = 2*(z*vx - x*vz); tz = 2*(x*vy - y*vx);       \
+        dst[0] = vx + w*tx + (y*tz - z*ty);                                     \
+        dst[1] = vy + w*ty + (z*tx - x*tz);                                     \
+        dst[2] = vz + w*tz + (x*ty - y*tx);                                     \
+        }                                                                       \
+    }
+
+/*------------------------------------------------------------------------------*
+ | Vectors                                                                      |
+ *------------------------------------------------------------------------------*/
+
+#define VEC3_NORMALIZE(T, S)                                                    \
+void moonglmath_batch_vec3_normalize##S(T *dst, const T *src, size_t count)     \
+/* dst[i] = src[i]/|src[i]| (zero vectors are left unchanged) */                \
+    {                                                                           \
+    size_t n;                                                                   \
+    double x, y, z, r;                                                          \
+    for(n = 0; n < count; n++, dst += 3, src += 3)                              \
+        {                                                                       \
+        x = src[0]; y = src[1]; z = src[2];                                     \
+        r = sqrt(x*x + y*y + z*z);                                              \
+        if(r != 0) { x /= r; y /= r; z /= r; }                                  \
+        dst[0] = x; dst[1] = y; dst[2] = z;                                     \
+        }                                                                       \
+    }
+
+#define VEC3_DOT(T, S)                                                          \
+void moonglmath_batch_vec3_dot##S(T *dst, const T *a, const T *b, size_t count) \
+/* dst[i] = a[i] . b[i] (dst is an array of count scalars) */                   \
+    {                                                                           \
+    size_t n;                                                                   \
+    for(n = 0; n < count; n++, a += 3, b += 3)                                  \
+        dst[n] = (double)a[0]*b[0] + (double)a[1]*b[1] + (double)a[2]*b[2];     \
+    }
+
+#define VEC3_CROSS(T, S)                                                        \
+void moonglmath_batch_vec3_cross##S(T *dst, const T *a, const T *b, size_t count) \
+/* dst[i] = a[i] x b[i] */                                                      \
+    {                                                                           \
+    size_t n;                                                                   \
+    double ax, ay, az, bx, by, bz;                                              \
+    for(n = 0; n < count; n++, dst += 3, a += 3, b += 3)                        \
+        {                                                                       \
+        ax = a[0]; ay = a[1]; az = a[2];                                        \
+        bx = b[0]; by = b[1]; bz = b[2];                                        \
+        dst[0] = ay*bz - az*by;                                                 \
+        dst[1] = az*bx - ax*bz;                                                 \
+        dst[2] = ax*by - ay*bx;                                                 \
+        }                                                                       \
+    }
+
+/*------------------------------------------------------------------------------*
+ | Instantiation                                                                |
+ *------------------------------------------------------------------------------*/
+
+#define BATCH_FUNCS(T, S)                                                       \
+    MAT4_MUL(T, S)                                                              \
+    MAT4_PREMUL(T, S)                                                           \
+    MAT4_TRANSFORM(T, S)                                                        \
+    MAT4_TRANSFORM3(T, S, transform_points, 1)                                  \
+    MAT4_TRANSFORM3(T, S, transform_dirs, 0)                                    \
+    QUAT_MUL(T, S)                                                              \
+    QUAT_ROTATE(T, S)                                                           \
+    VEC3_NORMALIZE(T, S)                                                        \
+    VEC3_DOT(T, S)                                                              \
+    VEC3_CROSS(T, S)
+
+BATCH_FUNCS(double, )
+BATCH_FUNCS(float, f)
+
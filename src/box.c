@@ -36,7 +36,7 @@ int testbox(lua_State *L, int arg, box_t b, size_t *dim)
     {
     size_t i;
     size_t dim_;
-    if(!testmetatable(L, arg, BOX_MT)) return 0;
+    if(typetag(L, arg) != TAG_BOX) return 0;
 
     lua_getfield(L, arg, "dimensions");   
     dim_ = luaL_checkinteger(L, -1);
@@ -227,6 +227,7 @@ static const struct luaL_Reg Functions[] =
 void moonglmath_open_box(lua_State *L)
     {
     newmetatable(L, BOX_MT);
+    settypetag(L, BOX_MT, TAG_BOX);
     metatable_setfuncs(L, BOX_MT, Metamethods, Methods);
     luaL_setfuncs(L, Functions, 0);
     }
@@ -0,0 +1,464 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Stefano Trettel
+ *
+ * Software repository: MoonGLMATH, https://github.com/stetre/moonglmath
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "internal.h"
+
+/* Camera.
+ *
+ * A camera stores the look_at() parameters (eye, target, up) and the parameters of a
+ * perspective(), frustum() or ortho() projection, and computes the derived matrices
+ * only when they are requested and the parameters they depend on have changed since
+ * the last time (each derived quantity has a 'valid' bit, which is cleared by the setters).
+ */
+
+#define PERSPECTIVE 0
+#define FRUSTUM     1
+#define ORTHO       2
+
+struct moonglmath_camera_s {
+    vec_t eye, target, up;
+    int projtype; /* PERSPECTIVE, FRUSTUM or ORTHO */
+    double proj[6]; /* projection parameters (as passed to perspective(), etc.) */
+    unsigned int valid;
+    int singular; /* the view-projection matrix is not invertible (if CAMERA_INVVIEWPROJ is valid) */
+    mat_t view, projection, viewproj, invviewproj;
+    double planes[6][4];
+};
+
+static void ComputeProjection(camera_t *cam)
+    {
+    double *p = cam->proj;
+    switch(cam->projtype)
+        {
+        case PERSPECTIVE: perspective(cam->projection, p[0], p[1], p[2], p[3]); break;
+        case FRUSTUM: frustum(cam->projection, p[0], p[1], p[2], p[3], p[4], p[5]); break;
+        case ORTHO: ortho(cam->projection, p[0], p[1], p[2], p[3], p[4], p[5]); break;
+        }
+    }
+
+static void ComputePlanes(camera_t *cam)
+/* Extracts the frustum planes (left, right, bottom, top, near, far) from the view-projection
+ * matrix (Gribb-Hartmann): plane = row4 +/- row_k. Each plane (a, b, c, d) is normalized so that
+ * a*x + b*y + c*z + d is the signed distance of (x, y, z) from it, positive on the inside.
+ */
+    {
+    int i, j;
+    double len, *pl;
+    mat_t *m = &cam->viewproj;
+    for(i = 0; i < 6; i++)
+        {
+        pl = cam->planes[i];
+        for(j = 0; j < 4; j++)
+            pl[j] = (*m)[3][j] + ((i % 2) ? -(*m)[i/2][j] : (*m)[i/2][j]);
+        len = sqrt(pl[0]*pl[0] + pl[1]*pl[1] + pl[2]*pl[2]);
+        if(len > 0)
+            for(j = 0; j < 4; j++) pl[j] /= len;
+        }
+    }
+
+int camera_update(camera_t *cam, unsigned int what)
+/* Recomputes the derived quantities in 'what' (and those they depend on), if not valid.
+ * Returns 0 if the inverse view-projection was requested and the camera is degenerate
+ * (in which case the inverse is set to zero), 1 otherwise.
+ */
+    {
+    unsigned int requested = what;
+    if(what & CAMERA_PLANES) what |= CAMERA_VIEWPROJ;
+    if(what & CAMERA_INVVIEWPROJ) what |= CAMERA_VIEWPROJ;
+    if(what & CAMERA_VIEWPROJ) what |= CAMERA_VIEW | CAMERA_PROJECTION;
+    what &= ~cam->valid;
+    if(what & CAMERA_VIEW)
+        look_at(cam->view, cam->eye, cam->target, cam->up);
+    if(what & CAMERA_PROJECTION)
+        ComputeProjection(cam);
+    if(what & CAMERA_VIEWPROJ)
+        mat_mul(cam->viewproj, cam->projection, cam->view, 4, 4, 4);
+    if(what & CAMERA_INVVIEWPROJ)
+        {
+        cam->singular = !mat_inv(cam->invviewproj, cam->viewproj, 4);
+        if(cam->singular)
+            mat_clear(cam->invviewproj); /* degenerate camera */
+        }
+    if(what & CAMERA_PLANES)
+        ComputePlanes(cam);
+    cam->valid |= what;
+    return !((requested & CAMERA_INVVIEWPROJ) && cam->singular);
+    }
+
+int camera_matrix(camera_t *cam, unsigned int what, mat_t dst)
+/* Copies the derived matrix 'what' (CAMERA_VIEW, ..., CAMERA_INVVIEWPROJ) to dst.
+ * Returns 0 if the matrix is the inverse of a singular view-projection (see camera_update()).
+ */
+    {
+    int ok = camera_update(cam, what);
+    switch(what)
+        {
+        case CAMERA_VIEW: mat_copy(dst, cam->view); break;
+        case CAMERA_PROJECTION: mat_copy(dst, cam->projection); break;
+        case CAMERA_VIEWPROJ: mat_copy(dst, cam->viewproj); break;
+        case CAMERA_INVVIEWPROJ: mat_copy(dst, cam->invviewproj); break;
+        default: mat_clear(dst);
+        }
+    return ok;
+    }
+
+/*------------------------------------------------------------------------------*
+ | Lua functions                                                                |
+ *------------------------------------------------------------------------------*/
+
+static int freecamera(lua_State *L, ud_t *ud)
+    {
+    camera_t *cam = (camera_t*)ud->handle;
+    if(!freeuserdata(L, ud, "camera")) return 0;
+    Free(L, cam);
+    return 0;
+    }
+
+static int Create(lua_State *L)
+/* camera() */
+    {
+    ud_t *ud;
+    camera_t *cam = (camera_t*)Malloc(L, sizeof(camera_t));
+    ud = newuserdata(L, cam, CAMERA_MT, "camera");
+    ud->destructor = freecamera;
+    cam->eye[2] = 1; /* eye = (0, 0, 1), target = (0, 0, 0), up = (0, 1, 0) */
+    cam->up[1] = 1;
+    cam->projtype = PERSPECTIVE;
+    cam->proj[0] = 0.78539816339744830962; /* fovy = pi/4 */
+    cam->proj[1] = 1; /* aspect */
+    cam->proj[2] = 0.1; /* near */
+    cam->proj[3] = 100; /* far */
+    cam->valid = 0;
+    return 1;
+    }
+
+static int LookAt(lua_State *L)
+/* look_at(eye, target, [up]) */
+    {
+    camera_t *cam = checkcamera(L, 1, NULL);
+    checkvec(L, 2, cam->eye, NULL, NULL);
+    checkvec(L, 3, cam->target, NULL, NULL);
+    if(!lua_isnoneornil(L, 4))
+        checkvec(L, 4, cam->up, NULL, NULL);
+    cam->valid &= ~(CAMERA_VIEW | CAMERA_VIEWPROJ | CAMERA_INVVIEWPROJ | CAMERA_PLANES);
+    return 0;
+    }
+
+static int GetLookAt(lua_State *L)
+    {
+    camera_t *cam = checkcamera(L, 1, NULL);
+    pushvec(L, cam->eye, 3, 3, 0);
+    pushvec(L, cam->target, 3, 3, 0);
+    pushvec(L, cam->up, 3, 3, 0);
+    return 3;
+    }
+
+static void SetProjection(camera_t *cam, int projtype)
+    {
+    cam->projtype = projtype;
+    cam->valid &= ~(CAMERA_PROJECTION | CAMERA_VIEWPROJ | CAMERA_INVVIEWPROJ | CAMERA_PLANES);
+    }
+
+static int Perspective(lua_State *L)
+/* perspective(fovy, aspect, near, far) */
+    {
+    int i;
+    camera_t *cam = checkcamera(L, 1, NULL);
+    for(i = 0; i < 4; i++)
+        cam->proj[i] = luaL_checknumber(L, i+2);
+    SetProjection(cam, PERSPECTIVE);
+    return 0;
+    }
+
+static int Frustum(lua_State *L)
+/* frustum(left, right, bottom, top, near, far) */
+    {
+    int i;
+    camera_t *cam = checkcamera(L, 1, NULL);
+    for(i = 0; i < 6; i++)
+        cam->proj[i] = luaL_checknumber(L, i+2);
+    SetProjection(cam, FRUSTUM);
+    return 0;
+    }
+
+static int Ortho(lua_State *L)
+/* ortho(left, right, bottom, top, [near], [far]) */
+    {
+    int i;
+    camera_t *cam = checkcamera(L, 1, NULL);
+    for(i = 0; i < 4; i++)
+        cam->proj[i] = luaL_checknumber(L, i+2);
+    cam->proj[4] = luaL_optnumber(L, 6, -1.0);
+    cam->proj[5] = luaL_optnumber(L, 7, 1.0);
+    SetProjection(cam, ORTHO);
+    return 0;
+    }
+
+static int Aspect(lua_State *L)
+/* aspect(aspect): changes the aspect ratio of a perspective projection */
+    {
+    camera_t *cam = checkcamera(L, 1, NULL);
+    double aspect = luaL_checknumber(L, 2);
+    if(cam->projtype != PERSPECTIVE)
+        return luaL_error(L, "not a perspective camera");
+    cam->proj[1] = aspect;
+    SetProjection(cam, PERSPECTIVE);
+    return 0;
+    }
+
+static const char *ProjTypes[] = { "perspective", "frustum", "ortho", NULL };
+
+static int GetProjection(lua_State *L)
+/* type, params... = get_projection() */
+    {
+    int i, n;
+    camera_t *cam = checkcamera(L, 1, NULL);
+    lua_pushstring(L, ProjTypes[cam->projtype]);
+    n = cam->projtype == PERSPECTIVE ? 4 : 6;
+    for(i = 0; i < n; i++)
+        lua_pushnumber(L, cam->proj[i]);
+    return n + 1;
+    }
+
+#define MATRIX_FUNC(Func, what, field)                  \
+static int Func(lua_State *L)                           \
+    {                                                   \
+    camera_t *cam = checkcamera(L, 1, NULL);            \
+    if(!camera_update(cam, what))                       \
+        return luaL_error(L, "singular matrix");        \
+    return pushmat(L, cam->field, 4, 4, 4, 4);          \
+    }
+MATRIX_FUNC(View, CAMERA_VIEW, view)
+MATRIX_FUNC(Projection, CAMERA_PROJECTION, projection)
+MATRIX_FUNC(ViewProjection, CAMERA_VIEWPROJ, viewproj)
+MATRIX_FUNC(InvViewProjection, CAMERA_INVVIEWPROJ, invviewproj)
+#undef MATRIX_FUNC
+
+static int Planes(lua_State *L)
+/* left, right, bottom, top, near, far = planes() */
+    {
+    int i;
+    camera_t *cam = checkcamera(L, 1, NULL);
+    camera_update(cam, CAMERA_PLANES);
+    for(i = 0; i < 6; i++)
+        pushvec(L, cam->planes[i], 4, 4, 0);
+    return 6;
+    }
+
+static const char *Matrices[] = 
+    { "view", "projection", "view_projection", "inverse_view_projection", NULL };
+
+static int Write(lua_State *L)
+/* write(hostmem, matrix, [index=1], [type]) */
+    {
+    int r, c;
+    char *p;
+    size_t count;
+    mat_t m;
+    camera_t *cam = checkcamera(L, 1, NULL);
+    int which = checkoption_hint(L, 3, NULL, Matrices);
+    lua_Integer index = luaL_optinteger(L, 4, 1);
+    int type = checkrealtype(L, 5);
+    if(index < 1) return luaL_argerror(L, 4, errstring(ERR_VALUE));
+    count = (size_t)index;
+    p = checkhostmemarray(L, 2, 0, 16 * sizeoftype(type), &count);
+    if(!camera_matrix(cam, 1U << which, m)) /* same order as the CAMERA_xxx flags */
+        return luaL_error(L, "singular matrix");
+    for(r = 0; r < 4; r++)
+        for(c = 0; c < 4; c++)
+            setreal(p, type, 16*(index-1) + 4*r + c, m[r][c]);
+    return 0;
+    }
+
+/*------------------------------------------------------------------------------*
+ | Cascaded shadow maps                                                         |
+ *------------------------------------------------------------------------------*/
+
+static void DepthRange(camera_t *cam, double *near, double *far)
+    {
+    if(cam->projtype == PERSPECTIVE)
+        { *near = cam->proj[2]; *far = cam->proj[3]; }
+    else
+        { *near = cam->proj[4]; *far = cam->proj[5]; }
+    }
+
+static int FrustumCorners(camera_t *cam, double corners[8][3])
+/* World coordinates of the corners of the view frustum: 0-3 on the near face, 
+ * 4-7 on the far face, with corners[k+4] at the far end of the edge from corners[k].
+ * Returns 0 if the camera is degenerate.
+ */
+    {
+    int i, k;
+    double ndc[3], c[4];
+    mat_t *m = &cam->invviewproj;
+    if(!camera_update(cam, CAMERA_INVVIEWPROJ)) return 0;
+    for(k = 0; k < 8; k++)
+        {
+        ndc[0] = (k & 1) ? 1 : -1;
+        ndc[1] = (k & 2) ? 1 : -1;
+        ndc[2] = (k & 4) ? 1 : -1;
+        for(i = 0; i < 4; i++)
+            c[i] = (*m)[i][0]*ndc[0] + (*m)[i][1]*ndc[1] + (*m)[i][2]*ndc[2] + (*m)[i][3];
+        for(i = 0; i < 3; i++)
+            corners[k][i] = c[i]/c[3];
+        }
+    return 1;
+    }
+
+static void Fit(double box[6], const double p[3], int first)
+    {
+    int i;
+    for(i = 0; i < 3; i++)
+        {
+        if(first || p[i] < box[2*i]) box[2*i] = p[i];
+        if(first || p[i] > box[2*i+1]) box[2*i+1] = p[i];
+        }
+    }
+
+static int Cascades(lua_State *L)
+/* splits, matrices, boxes = cascades(lightdir, n, [lambda=0.5], [extend=0])
+ *
+ * Splits the view frustum along the viewing direction into n slices, using the practical
+ * split scheme (Zhang et al., 'Parallel-Split Shadow Maps'): 
+ * split_i = lambda * near*(far/near)^(i/n) + (1-lambda) * (near + (far-near)*i/n),
+ * and fits a light-space ortho projection to each slice.
+ * The depth along the view direction is linear along the frustum edges (for both
+ * perspective and ortho projections), so the slice corners are obtained by linear 
+ * interpolation of the corners of the whole frustum.
+ */
+    {
+    int i, j, k;
+    lua_Integer n;
+    double lambda, extend, near, far, split, prev, t, len;
+    double corners[8][3], p[3], q[3], lbox[6];
+    vec_t dir, origin, up;
+    mat_t lightview, proj, m;
+    box_t wbox;
+    camera_t *cam = checkcamera(L, 1, NULL);
+    checkvec(L, 2, dir, NULL, NULL);
+    n = luaL_checkinteger(L, 3);
+    lambda = luaL_optnumber(L, 4, 0.5);
+    extend = luaL_optnumber(L, 5, 0);
+    if(n < 1) return luaL_argerror(L, 3, errstring(ERR_VALUE));
+    if(lambda < 0 || lambda > 1) return luaL_argerror(L, 4, errstring(ERR_VALUE));
+    len = sqrt(dir[0]*dir[0] + dir[1]*dir[1] + dir[2]*dir[2]);
+    if(len == 0) return luaL_argerror(L, 2, errstring(ERR_VALUE));
+
+    /* light view: rotation only, looking along dir (the translation goes in the ortho bounds) */
+    vec_clear(origin);
+    vec_clear(up);
+    dir[3] = 0;
+    if(fabs(dir[1]) > 0.99*len) up[0] = 1; else up[1] = 1;
+    look_at(lightview, origin, dir, up);
+
+    DepthRange(cam, &near, &far);
+    if(!FrustumCorners(cam, corners))
+        return luaL_error(L, "singular matrix");
+
+    lua_createtable(L, n+1, 0); /* splits */
+    lua_createtable(L, n, 0); /* matrices */
+    lua_createtable(L, n, 0); /* boxes */
+    lua_pushnumber(L, near);
+    lua_rawseti(L, -4, 1);
+    prev = near;
+    for(i = 1; i <= n; i++)
+        {
+        t = (double)i/n;
+        if(i == n)
+            split = far;
+        else if(near > 0 && far > near) /* the log term needs a positive near */
+            split = lambda*near*pow(far/near, t) + (1-lambda)*(near + (far-near)*t);
+        else
+            split = near + (far-near)*t;
+        box_clear(wbox);
+        for(k = 0; k < 8; k++)
+            {
+            /* slice corner on the edge from corners[k%4] to corners[k%4+4] */
+            t = ((k < 4 ? prev : split) - near)/(far - near);
+            for(j = 0; j < 3; j++)
+                p[j] = corners[k%4][j] + t*(corners[k%4+4][j] - corners[k%4][j]);
+            Fit(wbox, p, k == 0);
+            for(j = 0; j < 3; j++)
+                q[j] = lightview[j][0]*p[0] + lightview[j][1]*p[1] + lightview[j][2]*p[2];
+            Fit(lbox, q, k == 0);
+            }
+        /* the light looks down -z, so the nearest point to the light has the largest z */
+        ortho(proj, lbox[0], lbox[1], lbox[2], lbox[3], -lbox[5] - extend, -lbox[4]);
+        mat_mul(m, proj, lightview, 4, 4, 4);
+        lua_pushnumber(L, split);
+        lua_rawseti(L, -4, i+1);
+        pushmat(L, m, 4, 4, 4, 4);
+        lua_rawseti(L, -3, i);
+        pushbox(L, wbox, 3);
+        lua_rawseti(L, -2, i);
+        prev = split;
+        }
+    return 3;
+    }
+
+RAW_FUNC(camera)
+TYPE_FUNC(camera)
+DELETE_FUNC(camera)
+
+static const struct luaL_Reg Methods[] = 
+    {
+        { "raw", Raw },
+        { "type", Type },
+        { "free", Delete },
+        { "look_at", LookAt },
+        { "get_look_at", GetLookAt },
+        { "perspective", Perspective },
+        { "frustum", Frustum },
+        { "ortho", Ortho },
+        { "aspect", Aspect },
+        { "get_projection", GetProjection },
+        { "view", View },
+        { "projection", Projection },
+        { "view_projection", ViewProjection },
+        { "inverse_view_projection", InvViewProjection },
+        { "planes", Planes },
+        { "write", Write },
+        { "cascades", Cascades },
+        { NULL, NULL } /* sentinel */
+    };
+
+static const struct luaL_Reg MetaMethods[] = 
+    {
+        { "__gc",  Delete },
+        { NULL, NULL } /* sentinel */
+    };
+
+static const struct luaL_Reg Functions[] = 
+    {
+        { "camera", Create },
+        { NULL, NULL } /* sentinel */
+    };
+
+void moonglmath_open_camera(lua_State *L)
+    {
+    udata_define(L, CAMERA_MT, Methods, MetaMethods);
+    luaL_setfuncs(L, Functions, 0);
+    }
+
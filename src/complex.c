@@ -43,7 +43,7 @@ int testcomplex(lua_State *L, int arg, complex_t *z)
         return 1;
         }
 
-    if(!testmetatable(L, arg, COMPLEX_MT)) return 0;
+    if(typetag(L, arg) != TAG_COMPLEX) return 0;
 
     if(z != NULL)
         {
@@ -122,7 +122,7 @@ static int Complex(lua_State *L)
         y = luaL_optnumber(L, 2, 0);
         z = x + I*y;
         }
-    else if(t == LUA_TTABLE && !testmetatable(L, 1, COMPLEX_MT))
+    else if(t == LUA_TTABLE && typetag(L, 1) != TAG_COMPLEX)
         return ComplexArray(L);
     else
         checkcomplex(L, 1, &z);
@@ -316,6 +316,101 @@ int complex_Conj(lua_State *L)
     return pushcomplex(L, conj(z));
     }
 
+/*------------------------------------------------------------------------------*
+ | Two-number convention                                                        |
+ *------------------------------------------------------------------------------*/
+
+/* The cx_xxx() functions take complex arguments as pairs of plain numbers (re, im)
+ * and return complex results as two numbers, so that they do not create any Lua object.
+ */
+
+#define checkpair(L, arg) (luaL_checknumber((L), (arg)) + I*luaL_checknumber((L), (arg)+1))
+
+static int PushPair(lua_State *L, complex_t z)
+    {
+    lua_pushnumber(L, creal(z));
+    lua_pushnumber(L, cimag(z));
+    return 2;
+    }
+
+#define FUNC(Func, what)                \
+static int Func(lua_State *L)           \
+    {                                   \
+    complex_t z = checkpair(L, 1);      \
+    lua_pushnumber(L, what(z));         \
+    return 1;                           \
+    }
+
+FUNC(CxAbs, cabs)
+FUNC(CxArg, carg)
+
+#undef FUNC
+
+static int CxAbs2(lua_State *L)
+    {
+    double x = luaL_checknumber(L, 1);
+    double y = luaL_checknumber(L, 2);
+    lua_pushnumber(L, x*x + y*y);
+    return 1;
+    }
+
+#define FUNC(Func, what)                \
+static int Func(lua_State *L)           \
+    {                                   \
+    complex_t z = checkpair(L, 1);      \
+    return PushPair(L, what(z));        \
+    }
+
+FUNC(CxConj, conj)
+FUNC(CxSin, csin)
+FUNC(CxCos, ccos)
+FUNC(CxTan, ctan)
+FUNC(CxSinh, csinh)
+FUNC(CxCosh, ccosh)
+FUNC(CxTanh, ctanh)
+FUNC(CxLog, clog)
+FUNC(CxExp, cexp)
+FUNC(CxSqrt, csqrt)
+
+#undef FUNC
+
+static int CxInv(lua_State *L)
+    {
+    complex_t z = checkpair(L, 1);
+    return PushPair(L, 1/z);
+    }
+
+#define FUNC(Func, what)                \
+static int Func(lua_State *L)           \
+    {                                   \
+    complex_t z = checkpair(L, 1);      \
+    complex_t z1 = checkpair(L, 3);     \
+    return PushPair(L, z what z1);      \
+    }
+
+FUNC(CxAdd, +)
+FUNC(CxSub, -)
+FUNC(CxMul, *)
+FUNC(CxDiv, /)
+
+#undef FUNC
+
+static int CxPow(lua_State *L)
+    {
+    complex_t z = checkpair(L, 1);
+    complex_t z1 = checkpair(L, 3);
+    return PushPair(L, cpow(z, z1));
+    }
+
+static int CxMulAdd(lua_State *L)
+/* re, im = cx_muladd(are, aim, bre, bim, cre, cim) --> a*b + c */
+    {
+    complex_t a = checkpair(L, 1);
+    complex_t b = checkpair(L, 3);
+    complex_t c = checkpair(L, 5);
+    return PushPair(L, a*b + c);
+    }
+
 static const struct luaL_Reg Metamethods[] = 
     {
         { "__tostring", ToString },
@@ -393,12 +488,33 @@ static const struct luaL_Reg Functions[] =
         { "clog", Clog },
         { "cexp", Cexp },
         { "csqrt", Csqrt },
+        { "cx_abs", CxAbs },
+        { "cx_abs2", CxAbs2 },
+        { "cx_arg", CxArg },
+        { "cx_conj", CxConj },
+        { "cx_inv", CxInv },
+        { "cx_sin", CxSin },
+        { "cx_cos", CxCos },
+        { "cx_tan", CxTan },
+        { "cx_sinh", CxSinh },
+        { "cx_cosh", CxCosh },
+        { "cx_tanh", CxTanh },
+        { "cx_log", CxLog },
+        { "cx_exp", CxExp },
+        { "cx_sqrt", CxSqrt },
+        { "cx_add", CxAdd },
+        { "cx_sub", CxSub },
+        { "cx_mul", CxMul },
+        { "cx_div", CxDiv },
+        { "cx_pow", CxPow },
+        { "cx_muladd", CxMulAdd },
         { NULL, NULL } /* sentinel */
     };
 
 void moonglmath_open_complex(lua_State *L)
     {
     newmetatable(L, COMPLEX_MT);
+    settypetag(L, COMPLEX_MT, TAG_COMPLEX);
     metatable_setfuncs(L, COMPLEX_MT, Metamethods, Methods);
     luaL_setfuncs(L, Functions, 0);
     }
@@ -25,7 +25,8 @@
 
 #include "internal.h"
  
-/* @@TODO: what if host and device have different endianness?
+/* Packed data is in the host's byte order unless otherwise requested (see the optional
+ * 'endianness' arguments of pack(), unpack() and of the hostmem methods).
  */
 
 size_t sizeoftype(int type)
@@ -42,12 +43,274 @@ size_t sizeoftype(int type)
         case MOONGLMATH_TYPE_ULONG: return sizeof(uint64_t);
         case MOONGLMATH_TYPE_FLOAT:  return sizeof(float);
         case MOONGLMATH_TYPE_DOUBLE: return sizeof(double);
+        case MOONGLMATH_TYPE_HALF:   return sizeof(uint16_t);
+        case MOONGLMATH_TYPE_SNORM8: return sizeof(int8_t);
+        case MOONGLMATH_TYPE_UNORM8: return sizeof(uint8_t);
+        case MOONGLMATH_TYPE_SNORM16: return sizeof(int16_t);
+        case MOONGLMATH_TYPE_UNORM16: return sizeof(uint16_t);
+        case MOONGLMATH_TYPE_SNORM_2_10_10_10: return sizeof(uint32_t); /* 4 values */
+        case MOONGLMATH_TYPE_UNORM_2_10_10_10: return sizeof(uint32_t); /* 4 values */
         default:
             return 0;
         }
     return 0;
     }
 
+static int IsPacked(int type)
+/* Returns 1 if type encodes 4 values in a single element */
+    {
+    return (type == MOONGLMATH_TYPE_SNORM_2_10_10_10) || (type == MOONGLMATH_TYPE_UNORM_2_10_10_10);
+    }
+
+size_t sizeofvalues(int type, size_t n)
+/* Returns the size in bytes needed to encode n values of the given type, or 0 if n 
+ * is not valid for the type (packed types need a multiple of 4 values) */
+    {
+    if(IsPacked(type))
+        return (n % 4) ? 0 : n; /* (n/4) * 4 bytes */
+    return n * sizeoftype(type);
+    }
+
+/*-----------------------------------------------------------------------------*
+ | Byte order                                                                  |
+ *-----------------------------------------------------------------------------*/
+
+static int IsLittleEndian(void)
+    {
+    static const union { uint16_t u; uint8_t c[2]; } one = { 1 };
+    return one.c[0] == 1;
+    }
+
+int checkbyteswap(lua_State *L, int arg)
+/* Checks the optional endianness at arg ('native' by default), and returns 1 if data
+ * with the requested byte order must be byte-swapped to/from the host order.
+ */
+    {
+    int endianness = lua_isnoneornil(L, arg) ? MOONGLMATH_ENDIANNESS_NATIVE : checkendianness(L, arg);
+    switch(endianness)
+        {
+        case MOONGLMATH_ENDIANNESS_NATIVE: return 0;
+        case MOONGLMATH_ENDIANNESS_LITTLE: return !IsLittleEndian();
+        case MOONGLMATH_ENDIANNESS_BIG: return IsLittleEndian();
+        default:
+            break;
+        }
+    return unexpected(L);
+    }
+
+#if defined(__GNUC__) || defined(__clang__)
+#define BSWAP16(x) __builtin_bswap16(x)
+#define BSWAP32(x) __builtin_bswap32(x)
+#define BSWAP64(x) __builtin_bswap64(x)
+#else
+#define BSWAP16(x) ((uint16_t)(((x) >> 8) | ((x) << 8)))
+#define BSWAP32(x) ((((x) & 0xff000000u) >> 24) | (((x) & 0x00ff0000u) >> 8) | \
+                    (((x) & 0x0000ff00u) << 8) | (((x) & 0x000000ffu) << 24))
+#define BSWAP64(x) (((uint64_t)BSWAP32((uint32_t)(x)) << 32) | BSWAP32((uint32_t)((x) >> 32)))
+#endif
+
+void byteswap(void *data, size_t elemsize, size_t count)
+/* Reverses in place the byte order of count elements of elemsize bytes each.
+ * The loops are branch-free and work on unaligned data (memcpy() of fixed size
+ * compiles to plain loads/stores), so that the compiler can vectorize them.
+ */
+    {
+    size_t i;
+    char *p = (char*)data;
+    switch(elemsize)
+        {
+#define S(T, B) do {                                            \
+        T x;                                                    \
+        for(i = 0; i < count; i++, p += sizeof(T))              \
+            { memcpy(&x, p, sizeof(T)); x = B(x); memcpy(p, &x, sizeof(T)); } \
+        } while(0)
+        case 1: break;
+        case 2: S(uint16_t, BSWAP16); break;
+        case 4: S(uint32_t, BSWAP32); break;
+        case 8: S(uint64_t, BSWAP64); break;
+#undef S
+        default:
+            break;
+        }
+    }
+
+int checkrealtype(lua_State *L, int arg)
+/* Checks the optional type of a packed array of real numbers, which may be
+ * either 'float' (default) or 'double'.
+ */
+    {
+    int type;
+    if(lua_isnoneornil(L, arg))
+        return MOONGLMATH_TYPE_FLOAT;
+    type = checktype(L, arg);
+    if((type != MOONGLMATH_TYPE_FLOAT) && (type != MOONGLMATH_TYPE_DOUBLE))
+        return luaL_argerror(L, arg, "'float' or 'double' expected");
+    return type;
+    }
+
+/*-----------------------------------------------------------------------------*
+ | Conversions                                                                 |
+ *-----------------------------------------------------------------------------*/
+
+typedef union { float f; uint32_t u; } fp32_t;
+
+uint16_t float_to_half(float x)
+/* IEEE 754 binary32 to binary16, with round to nearest even.
+ * Rfr: F. Giesen, "float->half variants", https://gist.github.com/rygorous/2156668
+ */
+    {
+    fp32_t f, denorm_magic;
+    uint32_t sign, mant_odd;
+    uint16_t h;
+    f.f = x;
+    denorm_magic.u = ((127 - 15) + (23 - 10) + 1) << 23;
+    sign = f.u & 0x80000000u;
+    f.u ^= sign;
+    if(f.u >= ((127 + 16) << 23)) /* overflow, Inf or NaN */
+        h = (f.u > (255u << 23)) ? 0x7e00 : 0x7c00;
+    else if(f.u < (113 << 23)) /* subnormal or zero */
+        {
+        f.f += denorm_magic.f;
+        h = (uint16_t)(f.u - denorm_magic.u);
+        }
+    else
+        {
+        mant_odd = (f.u >> 13) & 1;
+        f.u -= 112u << 23; /* rebias the exponent */
+        f.u += 0xfff + mant_odd; /* round */
+        h = (uint16_t)(f.u >> 13);
+        }
+    return h | (uint16_t)(sign >> 16);
+    }
+
+float half_to_float(uint16_t h)
+    {
+    fp32_t o, magic;
+    uint32_t exp;
+    magic.u = 113 << 23;
+    o.u = (uint32_t)(h & 0x7fff) << 13;
+    exp = o.u & (0x7c00u << 13);
+    o.u += (127 - 15) << 23;
+    if(exp == (0x7c00u << 13)) /* Inf or NaN */
+        o.u += (128 - 16) << 23;
+    else if(exp == 0) /* zero or subnormal */
+        {
+        o.u += 1 << 23;
+        o.f -= magic.f;
+        }
+    o.u |= (uint32_t)(h & 0x8000) << 16;
+    return o.f;
+    }
+
+/* Normalized integers (same rules as OpenGL 4.2+) */
+#define SNORM(x, max) (lrint(((x) < -1.0 ? -1.0 : ((x) > 1.0 ? 1.0 : (x))) * (max)))
+#define UNORM(x, max) (lrint(((x) < 0.0 ? 0.0 : ((x) > 1.0 ? 1.0 : (x))) * (max)))
+#define FROM_SNORM(c, max) ((c) <= -(max) ? -1.0 : (double)(c) / (max))
+#define FROM_UNORM(c, max) ((double)(c) / (max))
+
+void encodevalues(int type, const double *src, size_t n, void *dst)
+/* Encodes n values from src to dst according to type (for packed types, n must be
+ * a multiple of 4). Values are cast (or converted, for normalized types) without checks. 
+ */
+    {
+    size_t i;
+    uint32_t *p;
+    switch(type)
+        {
+#define E(T, expr) do { T *d = (T*)dst; for(i = 0; i < n; i++) d[i] = (T)(expr); } while(0)
+        case MOONGLMATH_TYPE_CHAR:   E(int8_t, src[i]); break;
+        case MOONGLMATH_TYPE_UCHAR:  E(uint8_t, src[i]); break;
+        case MOONGLMATH_TYPE_SHORT:  E(int16_t, src[i]); break;
+        case MOONGLMATH_TYPE_USHORT: E(uint16_t, src[i]); break;
+        case MOONGLMATH_TYPE_INT:    E(int32_t, src[i]); break;
+        case MOONGLMATH_TYPE_UINT:   E(uint32_t, src[i]); break;
+        case MOONGLMATH_TYPE_LONG:   E(int64_t, src[i]); break;
+        case MOONGLMATH_TYPE_ULONG:  E(uint64_t, src[i]); break;
+        case MOONGLMATH_TYPE_FLOAT:  E(float, src[i]); break;
+        case MOONGLMATH_TYPE_DOUBLE: E(double, src[i]); break;
+        case MOONGLMATH_TYPE_HALF:   E(uint16_t, float_to_half((float)src[i])); break;
+        case MOONGLMATH_TYPE_SNORM8: E(int8_t, SNORM(src[i], 127)); break;
+        case MOONGLMATH_TYPE_UNORM8: E(uint8_t, UNORM(src[i], 255)); break;
+        case MOONGLMATH_TYPE_SNORM16: E(int16_t, SNORM(src[i], 32767)); break;
+        case MOONGLMATH_TYPE_UNORM16: E(uint16_t, UNORM(src[i], 65535)); break;
+#undef E
+        case MOONGLMATH_TYPE_SNORM_2_10_10_10:
+            p = (uint32_t*)dst;
+            for(i = 0; i < n/4; i++, src += 4)
+                p[i] = ((uint32_t)SNORM(src[0], 511) & 0x3ff) | (((uint32_t)SNORM(src[1], 511) & 0x3ff) << 10) |
+                       (((uint32_t)SNORM(src[2], 511) & 0x3ff) << 20) | (((uint32_t)SNORM(src[3], 1) & 0x3) << 30);
+            break;
+        case MOONGLMATH_TYPE_UNORM_2_10_10_10:
+            p = (uint32_t*)dst;
+            for(i = 0; i < n/4; i++, src += 4)
+                p[i] = (uint32_t)UNORM(src[0], 1023) | ((uint32_t)UNORM(src[1], 1023) << 10) |
+                       ((uint32_t)UNORM(src[2], 1023) << 20) | ((uint32_t)UNORM(src[3], 3) << 30);
+            break;
+        default:
+            break;
+        }
+    }
+
+static int32_t SignExtend(uint32_t x, int bits)
+    {
+    uint32_t m = 1u << (bits - 1);
+    return (int32_t)((x ^ m) - m);
+    }
+
+void decodevalues(int type, const void *src, size_t n, double *dst)
+/* Inverse of encodevalues() */
+    {
+    size_t i;
+    const uint32_t *p;
+    switch(type)
+        {
+#define D(T, expr) do { const T *s = (const T*)src; for(i = 0; i < n; i++) dst[i] = (expr); } while(0)
+        case MOONGLMATH_TYPE_CHAR:   D(int8_t, s[i]); break;
+        case MOONGLMATH_TYPE_UCHAR:  D(uint8_t, s[i]); break;
+        case MOONGLMATH_TYPE_SHORT:  D(int16_t, s[i]); break;
+        case MOONGLMATH_TYPE_USHORT: D(uint16_t, s[i]); break;
+        case MOONGLMATH_TYPE_INT:    D(int32_t, s[i]); break;
+        case MOONGLMATH_TYPE_UINT:   D(uint32_t, s[i]); break;
+        case MOONGLMATH_TYPE_LONG:   D(int64_t, (double)s[i]); break;
+        case MOONGLMATH_TYPE_ULONG:  D(uint64_t, (double)s[i]); break;
+        case MOONGLMATH_TYPE_FLOAT:  D(float, s[i]); break;
+        case MOONGLMATH_TYPE_DOUBLE: D(double, s[i]); break;
+        case MOONGLMATH_TYPE_HALF:   D(uint16_t, half_to_float(s[i])); break;
+        case MOONGLMATH_TYPE_SNORM8: D(int8_t, FROM_SNORM(s[i], 127)); break;
+        case MOONGLMATH_TYPE_UNORM8: D(uint8_t, FROM_UNORM(s[i], 255)); break;
+        case MOONGLMATH_TYPE_SNORM16: D(int16_t, FROM_SNORM(s[i], 32767)); break;
+        case MOONGLMATH_TYPE_UNORM16: D(uint16_t, FROM_UNORM(s[i], 65535)); break;
+#undef D
+        case MOONGLMATH_TYPE_SNORM_2_10_10_10:
+            p = (const uint32_t*)src;
+            for(i = 0; i < n/4; i++, dst += 4)
+                {
+                dst[0] = FROM_SNORM(SignExtend(p[i] & 0x3ff, 10), 511);
+                dst[1] = FROM_SNORM(SignExtend((p[i] >> 10) & 0x3ff, 10), 511);
+                dst[2] = FROM_SNORM(SignExtend((p[i] >> 20) & 0x3ff, 10), 511);
+                dst[3] = FROM_SNORM(SignExtend(p[i] >> 30, 2), 1);
+                }
+            break;
+        case MOONGLMATH_TYPE_UNORM_2_10_10_10:
+            p = (const uint32_t*)src;
+            for(i = 0; i < n/4; i++, dst += 4)
+                {
+                dst[0] = FROM_UNORM(p[i] & 0x3ff, 1023);
+                dst[1] = FROM_UNORM((p[i] >> 10) & 0x3ff, 1023);
+                dst[2] = FROM_UNORM((p[i] >> 20) & 0x3ff, 1023);
+                dst[3] = FROM_UNORM(p[i] >> 30, 3);
+                }
+            break;
+        default:
+            break;
+        }
+    }
+
+#undef SNORM
+#undef UNORM
+#undef FROM_SNORM
+#undef FROM_UNORM
+
 static int Sizeof(lua_State *L)
 /* size = sizeof(type) */
     {
@@ -56,66 +319,151 @@ static int Sizeof(lua_State *L)
     return 1;
     }
 
-static int Flatten1_(lua_State *L, int table_index, int cur_index, int arg)
-    {
-    int len, i, top, m, n=0;
+/* Flattening of nested tables.
+ *
+ * Tables are walked iteratively, keeping the tables being visited on the Lua stack, and 
+ * the values are copied into a table preallocated with the expected size (that is, assuming
+ * that all the elements have the same size as the first one, e.g. an array of vec3). 
+ * An already flat table is detected with a quick scan and used as is, when possible.
+ * Lengths and elements are accessed with raw functions, unless the table has a __len 
+ * metamethod (as for proxy tables), in which case its metamethods are honored.
+ * There is no fixed limit on the nesting depth: the stack of levels starts in a local
+ * array and, if needed, moves to a userdata that is doubled when full (garbage collected,
+ * so that nothing leaks if an error is raised while walking).
+ */
+
+#define NLEVELS 32 /* levels in the local array */
 
-    if(lua_type(L, arg) != LUA_TTABLE)
-        return luaL_error(L, "table expected");
+typedef struct {
+    int index;      /* stack index of the table */
+    int raw;        /* 1 if the table has no __len metamethod */
+    lua_Integer i;  /* current element */
+    lua_Integer len;
+} level_t;
 
-    lua_len(L, arg);
+static lua_Integer Len(lua_State *L, int index, int *raw)
+    {
+    lua_Integer len;
+    *raw = (luaL_getmetafield(L, index, "__len") == LUA_TNIL);
+    if(*raw)
+        return (lua_Integer)lua_rawlen(L, index);
+    lua_pop(L, 1);
+    lua_len(L, index);
     len = lua_tointeger(L, -1);
     lua_pop(L, 1);
+    return len;
+    }
 
-    if(len==0) return n;
-
-    for(i=1; i<=len; i++)
+static int Walk(lua_State *L, int arg, int dst)
+/* Walks the (possibly nested) table at arg, copies its non-table values in the 
+ * table at dst, and returns their number.
+ */
+    {
+    level_t local[NLEVELS];
+    level_t *level = local, *lv;
+    int depth = 0, n = 0, cap = NLEVELS, buf;
+    lua_pushnil(L); /* placeholder for the userdata holding the levels, if needed */
+    buf = lua_gettop(L);
+    lv = &level[0];
+    lv->index = arg;
+    lv->i = 0;
+    lv->len = Len(L, arg, &lv->raw);
+    while(depth >= 0)
         {
-        lua_geti(L, arg, i);
-        top = lua_gettop(L);
-        if(lua_type(L, top) == LUA_TTABLE)
+        lv = &level[depth];
+        if(lv->i >= lv->len) /* done with this table */
             {
-            m = Flatten1_(L, table_index, cur_index, top);
-            n += m;
-            cur_index += m;
-            lua_remove(L, top);
+            if(depth > 0) lua_pop(L, 1);
+            depth--;
+            continue;
             }
+        lv->i++;
+        if(lv->raw)
+            lua_rawgeti(L, lv->index, lv->i);
         else
+            lua_geti(L, lv->index, lv->i);
+        if(lua_type(L, -1) == LUA_TTABLE)
             {
-            n++;
-            cur_index++;
-            lua_rawseti(L, table_index, cur_index);
+            if(depth == cap - 1)
+                {
+                lv = (level_t*)lua_newuserdata(L, 2 * cap * sizeof(level_t));
+                memcpy(lv, level, cap * sizeof(level_t));
+                lua_replace(L, buf); /* releases the previous one, if any */
+                level = lv;
+                cap *= 2;
+                }
+            luaL_checkstack(L, 2, "too many nesting levels");
+            lv = &level[++depth];
+            lv->index = lua_gettop(L);
+            lv->i = 0;
+            lv->len = Len(L, lv->index, &lv->raw);
+            continue;
             }
+        lua_rawseti(L, dst, ++n);
         }
+    lua_pop(L, 1); /* placeholder */
     return n;
     }
 
-int toflattable(lua_State *L, int arg)
-/* Creates a flat table with all the arguments starting from arg, and leaves 
- * it on top of the stack.
- */
+static lua_Integer Scan(lua_State *L, int arg, int *flat)
+/* Returns the expected number of values in the table at arg, and whether it is flat
+ * (proxy tables are never considered flat, since their elements are not raw accessible) */
     {
-    int table_index, last_arg, i, n;
-    if(lua_type(L, arg) == LUA_TTABLE)
+    int raw, elemraw, t;
+    lua_Integer i, len = Len(L, arg, &raw), elemlen = 1;
+    *flat = raw;
+    for(i = 1; i <= len; i++)
         {
-        lua_newtable(L);
-        n = Flatten1_(L, lua_gettop(L), 0, arg);
+        t = raw ? lua_rawgeti(L, arg, i) : lua_geti(L, arg, i);
+        if(t == LUA_TTABLE)
+            {
+            elemlen = Len(L, -1, &elemraw); /* first nested table */
+            *flat = 0;
+            }
+        lua_pop(L, 1);
+        if(!*flat) break;
         }
+    return len * elemlen;
+    }
+
+static int ToFlatTable(lua_State *L, int arg, int copy)
+/* If copy=0 and the table is already flat, it just pushes it (the returned table must not
+ * be modified in this case).
+ */
+    {
+    int table_index, last_arg, i, flat, dst;
+    lua_Integer n;
+    if(lua_type(L, arg) == LUA_TTABLE)
+        table_index = lua_absindex(L, arg);
     else
         {
         /* create a table with all the arguments, and flatten it */
         last_arg = lua_gettop(L);
-        lua_newtable(L);
+        lua_createtable(L, last_arg - arg + 1, 0);
         table_index = lua_gettop(L);
         for(i=arg; i <= last_arg; i++)
             {
             lua_pushvalue(L, i);
             lua_rawseti(L, table_index, i-arg+1);
             }
-        lua_newtable(L);
-        n = Flatten1_(L, lua_gettop(L), 0, table_index);
         }
-    return n;
+    n = Scan(L, table_index, &flat);
+    if(flat && !copy)
+        {
+        lua_pushvalue(L, table_index);
+        return n;
+        }
+    lua_createtable(L, n < INT_MAX ? (int)n : 0, 0);
+    dst = lua_gettop(L);
+    return Walk(L, table_index, dst);
+    }
+
+int toflattable(lua_State *L, int arg)
+/* Creates a flat table with all the arguments starting from arg, and leaves 
+ * it on top of the stack (if arg is an already flat table, the table itself is used).
+ */
+    {
+    return ToFlatTable(L, arg, 0);
     }
 
 static int Flatten(lua_State *L)
@@ -131,7 +479,7 @@ static int Flatten(lua_State *L)
 
 static int FlattenTable(lua_State *L)
     {
-    toflattable(L, 1);
+    ToFlatTable(L, 1, 1);
     return 1;
     }
 
@@ -174,18 +522,177 @@ PACK_INTEGERS(uint32_t)
 PACK_INTEGERS(int64_t)
 PACK_INTEGERS(uint64_t)
 
+#define CHUNK 256 /* values converted at a time */
+
+static int PackValues(lua_State *L, int type, size_t n, void *dst, size_t dstsize, int *faulty_element)
+/* Pack function for types that need a conversion (half and normalized types) */
+    {
+    int isnum;
+    size_t i, j, nchunk, size = sizeofvalues(type, n);
+    double buf[CHUNK];
+    char *p = (char*)dst;
+    if(faulty_element) *faulty_element = 0;
+    if((size == 0) || (dstsize < size))
+        return ERR_LENGTH;
+    for(i = 0; i < n; i += nchunk)
+        {
+        nchunk = (n - i) < CHUNK ? (n - i) : CHUNK;
+        for(j = 0; j < nchunk; j++)
+            {
+            lua_rawgeti(L, -1, i+j+1);
+            buf[j] = lua_tonumberx(L, -1, &isnum);
+            if(!isnum)
+                {
+                if(faulty_element) *faulty_element = i+j+1;
+                return ERR_TYPE;
+                }
+            lua_pop(L, 1);
+            }
+        encodevalues(type, buf, nchunk, p);
+        p += sizeofvalues(type, nchunk);
+        }
+    return 0;
+    }
+
+/* Fast path for arrays of vectors or matrices.
+ *
+ * An array whose elements are all vectors of the same size, or all matrices of the same
+ * size, is packed reading the components directly from the elements, with no intermediate
+ * flat table. Elements of the same shape share the same per-shape metatable, so the check
+ * is a metatable comparison. The components are converted in chunks via encodevalues(),
+ * which casts without checks, so integer types (whose values must be checked) are left 
+ * to the generic path.
+ */
+
+static int Shape(lua_State *L, int index, int *rows, int *cols)
+/* If the element at index is a vector or a matrix with a per-shape metatable, returns
+ * its tag and sets its shape (1 x size for vectors). Otherwise returns 0. */
+    {
+    int tag = typetag(L, index);
+    if(tag != TAG_VEC && tag != TAG_MAT) return 0;
+    if(!lua_getmetatable(L, index)) return 0;
+    lua_pushliteral(L, "__family");
+    if(lua_rawget(L, -2) != LUA_TSTRING) { lua_pop(L, 2); return 0; }
+    lua_pop(L, 2);
+    *rows = 1;
+    if(tag == TAG_MAT)
+        {
+        lua_getfield(L, index, "rows");
+        *rows = (int)lua_tointeger(L, -1);
+        lua_pop(L, 1);
+        }
+    lua_getfield(L, index, tag == TAG_VEC ? "size" : "columns");
+    *cols = (int)lua_tointeger(L, -1);
+    lua_pop(L, 1);
+    if(*rows < 1 || *rows > 4 || *cols < 1 || *cols > 4) return 0;
+    return tag;
+    }
+
+static int PackShaped(lua_State *L, int arg, int type, size_t len, char **dstp, size_t *dstsizep)
+/* Packs the array at arg if its elements are all vectors or matrices of the same shape,
+ * and returns 1. Otherwise returns 0 (with nothing allocated), and the caller falls back 
+ * to the generic path, which also takes care of the errors.
+ */
+    {
+    int tag, top, rows = 0, cols = 0, r, c, isnum, ok = 1;
+    size_t i, nbuf = 0, dstsize;
+    double buf[CHUNK], x;
+    char *dst, *p;
+
+    switch(type)
+        {
+        case MOONGLMATH_TYPE_FLOAT: case MOONGLMATH_TYPE_DOUBLE: case MOONGLMATH_TYPE_HALF:
+        case MOONGLMATH_TYPE_SNORM8: case MOONGLMATH_TYPE_UNORM8: case MOONGLMATH_TYPE_SNORM16:
+        case MOONGLMATH_TYPE_UNORM16: case MOONGLMATH_TYPE_SNORM_2_10_10_10:
+        case MOONGLMATH_TYPE_UNORM_2_10_10_10: break;
+        default: return 0;
+        }
+    lua_rawgeti(L, arg, 1);
+    tag = Shape(L, -1, &rows, &cols);
+    dstsize = sizeofvalues(type, len * rows * cols);
+    if(tag == 0 || dstsize == 0)
+        { lua_pop(L, 1); return 0; }
+    lua_getmetatable(L, -1);
+    lua_remove(L, -2);
+    top = lua_gettop(L); /* the metatable shared by all the elements */
+    p = dst = (char*)Malloc(L, dstsize);
+    for(i = 1; i <= len && ok; i++)
+        {
+        lua_rawgeti(L, arg, i);
+        ok = lua_getmetatable(L, -1) && lua_rawequal(L, -1, top);
+        lua_settop(L, top + 1); /* the element */
+        for(r = 0; r < rows && ok; r++)
+            {
+            if(tag == TAG_MAT)
+                {
+                lua_settop(L, top + 1);
+                ok = (lua_rawgeti(L, top + 1, r+1) == LUA_TTABLE); /* row */
+                }
+            for(c = 0; c < cols && ok; c++)
+                {
+                lua_rawgeti(L, -1, c+1);
+                x = lua_tonumberx(L, -1, &isnum);
+                lua_pop(L, 1);
+                ok = isnum;
+                buf[nbuf++] = x;
+                if(nbuf == CHUNK)
+                    {
+                    encodevalues(type, buf, nbuf, p);
+                    p += sizeofvalues(type, nbuf);
+                    nbuf = 0;
+                    }
+                }
+            }
+        lua_settop(L, top);
+        }
+    lua_pop(L, 1);
+    if(!ok) 
+        { Free(L, dst); return 0; }
+    if(nbuf > 0)
+        encodevalues(type, buf, nbuf, p);
+    *dstp = dst;
+    *dstsizep = dstsize;
+    return 1;
+    }
+
 static int Pack(lua_State *L)
+/* pack(type, ...)
+ * A table argument is packed directly, with the flatness check folded in the packing loop: 
+ * if an element turns out to be a table, it falls back to the vec/mat fast path or to 
+ * toflattable(). Proxy tables (with __len) always take the generic path.
+ */
     {
-    int err = 0;
+    int err = 0, faulty = 0, direct = 0;
     void *dst = NULL;
-    size_t dstsize = 0;
+    size_t dstsize = 0, n = 0;
     int type = checktype(L, 1);
-    size_t n = toflattable(L, 2);
+    int swap = lua_istable(L, 2) ? checkbyteswap(L, 3) : 0;
+    if(lua_istable(L, 2) && luaL_getmetafield(L, 2, "__len") == LUA_TNIL)
+        {
+        n = lua_rawlen(L, 2);
+        if(n > 0 && lua_rawgeti(L, 2, 1) == LUA_TTABLE)
+            {
+            lua_pop(L, 1);
+            if(PackShaped(L, 2, type, n, (char**)&dst, &dstsize))
+                goto done;
+            }
+        else
+            {
+            if(n > 0) lua_pop(L, 1);
+            direct = 1;
+            lua_pushvalue(L, 2);
+            }
+        }
+    else if(lua_istable(L, 2))
+        lua_pop(L, 1); /* __len */
+again:
+    if(!direct)
+        n = toflattable(L, 2);
     switch(type)
         {
 #define P(T) do { dstsize = n * sizeof(T);      \
                   dst = Malloc(L, dstsize);     \
-                  err = Pack##T(L, n, dst, dstsize, NULL); } while(0)
+                  err = Pack##T(L, n, dst, dstsize, &faulty); } while(0)
 
         case MOONGLMATH_TYPE_CHAR:   P(int8_t); break;
         case MOONGLMATH_TYPE_UCHAR:  P(uint8_t); break;
@@ -197,6 +704,22 @@ static int Pack(lua_State *L)
         case MOONGLMATH_TYPE_ULONG:  P(uint64_t); break;
         case MOONGLMATH_TYPE_FLOAT:  P(float); break;
         case MOONGLMATH_TYPE_DOUBLE: P(double); break;
+        case MOONGLMATH_TYPE_HALF:
+        case MOONGLMATH_TYPE_SNORM8:
+        case MOONGLMATH_TYPE_UNORM8:
+        case MOONGLMATH_TYPE_SNORM16:
+        case MOONGLMATH_TYPE_UNORM16:
+        case MOONGLMATH_TYPE_SNORM_2_10_10_10:
+        case MOONGLMATH_TYPE_UNORM_2_10_10_10:
+            dstsize = sizeofvalues(type, n);
+            if(dstsize == 0)
+                {
+                if(direct) { direct = 0; lua_pop(L, 1); goto again; } /* may be nested */
+                return luaL_argerror(L, 2, errstring(ERR_LENGTH));
+                }
+            dst = Malloc(L, dstsize);
+            err = PackValues(L, type, n, dst, dstsize, &faulty);
+            break;
         default:
             return unexpected(L);
 #undef P
@@ -204,8 +727,17 @@ static int Pack(lua_State *L)
     if(err)
         {
         Free(L, dst);
+        if(direct && err == ERR_TYPE && lua_type(L, -1) == LUA_TTABLE)
+            { /* not flat after all: the faulty element is on top, above the table */
+            direct = 0;
+            lua_pop(L, 2);
+            goto again;
+            }
         return luaL_argerror(L, 2, errstring(err));
         }
+done:
+    if(swap)
+        byteswap(dst, sizeoftype(type), dstsize / sizeoftype(type));
     lua_pushlstring(L, (char*)dst, dstsize);
     Free(L, dst);
     return 1;
@@ -245,6 +777,30 @@ UNPACK_INTEGERS(uint32_t)
 UNPACK_INTEGERS(int64_t)
 UNPACK_INTEGERS(uint64_t)
 
+static int UnpackValues(lua_State *L, int type, const void *data, size_t len)
+/* Unpack function for types that need a conversion (half and normalized types) */
+    {
+    size_t i, j, n, nchunk, elemsize = sizeoftype(type);
+    double buf[CHUNK];
+    const char *p = (const char*)data;
+    if((len < elemsize) || (len % elemsize) != 0)
+        return ERR_LENGTH;
+    n = IsPacked(type) ? len : len / elemsize; /* no. of values */
+    lua_newtable(L);
+    for(i = 0; i < n; i += nchunk)
+        {
+        nchunk = (n - i) < CHUNK ? (n - i) : CHUNK;
+        decodevalues(type, p, nchunk, buf);
+        p += sizeofvalues(type, nchunk);
+        for(j = 0; j < nchunk; j++)
+            {
+            lua_pushnumber(L, buf[j]);
+            lua_rawseti(L, -2, i+j+1);
+            }
+        }
+    return 0;
+    }
+
 static int Unpack_(lua_State *L, int type, const void *data, size_t len)
     {
     int err = 0;
@@ -260,6 +816,14 @@ static int Unpack_(lua_State *L, int type, const void *data, size_t len)
         case MOONGLMATH_TYPE_ULONG:  err = Unpackuint64_t(L, data, len); break;
         case MOONGLMATH_TYPE_FLOAT:  err = Unpackfloat(L, data, len); break;
         case MOONGLMATH_TYPE_DOUBLE: err = Unpackdouble(L, data, len); break;
+        case MOONGLMATH_TYPE_HALF:
+        case MOONGLMATH_TYPE_SNORM8:
+        case MOONGLMATH_TYPE_UNORM8:
+        case MOONGLMATH_TYPE_SNORM16:
+        case MOONGLMATH_TYPE_UNORM16:
+        case MOONGLMATH_TYPE_SNORM_2_10_10_10:
+        case MOONGLMATH_TYPE_UNORM_2_10_10_10:
+            err = UnpackValues(L, type, data, len); break;
         default:
             return unexpected(L);
         }
@@ -269,11 +833,26 @@ static int Unpack_(lua_State *L, int type, const void *data, size_t len)
     }
 
 
+static int UnpackSwapped(lua_State *L, int type, const void *data, size_t len)
+/* Unpacks data in the non-native byte order, using a swapped copy */
+    {
+    size_t elemsize = sizeoftype(type);
+    void *tmp;
+    if((len < elemsize) || (len % elemsize) != 0)
+        return luaL_error(L, errstring(ERR_LENGTH));
+    tmp = lua_newuserdata(L, len); /* garbage collected */
+    memcpy(tmp, data, len);
+    byteswap(tmp, elemsize, len / elemsize);
+    return Unpack_(L, type, tmp, len);
+    }
+
 static int Unpack(lua_State *L)
     {
     size_t len;
     int type = checktype(L, 1);
     const void *data = luaL_checklstring(L, 2, &len);
+    if(checkbyteswap(L, 3))
+        return UnpackSwapped(L, type, data, len);
     return Unpack_(L, type, data, len);
     }
 
@@ -300,6 +879,14 @@ int testdata(lua_State *L, int type, size_t n, void *dst, size_t dstsize)
         case MOONGLMATH_TYPE_ULONG:  P(uint64_t); break;
         case MOONGLMATH_TYPE_FLOAT:  P(float); break;
         case MOONGLMATH_TYPE_DOUBLE: P(double); break;
+        case MOONGLMATH_TYPE_HALF:
+        case MOONGLMATH_TYPE_SNORM8:
+        case MOONGLMATH_TYPE_UNORM8:
+        case MOONGLMATH_TYPE_SNORM16:
+        case MOONGLMATH_TYPE_UNORM16:
+        case MOONGLMATH_TYPE_SNORM_2_10_10_10:
+        case MOONGLMATH_TYPE_UNORM_2_10_10_10:
+            err = PackValues(L, type, n, dst, dstsize, NULL); break;
         default:
             return unexpected(L);
 #undef P
@@ -307,7 +894,8 @@ int testdata(lua_State *L, int type, size_t n, void *dst, size_t dstsize)
     return err;
     }
 
-int checkdata(lua_State *L, int arg, int type, void *dst, size_t dstsize)
+int checkdata(lua_State *L, int arg, int type, void *dst, size_t dstsize, int swap)
+/* If swap=1, the data is packed in the non-native byte order */
     {
     size_t n = toflattable(L, arg);
     int err = testdata(L, type, n, dst, dstsize);
@@ -316,12 +904,17 @@ int checkdata(lua_State *L, int arg, int type, void *dst, size_t dstsize)
         lua_pop(L, 1); /* flat table */
         return luaL_argerror(L, arg, errstring(err));
         }
+    if(swap)
+        byteswap(dst, sizeoftype(type), sizeofvalues(type, n) / sizeoftype(type));
     return 0;
     }
 
 
-int pushdata(lua_State *L, int type, void *data, size_t datalen)
+int pushdata(lua_State *L, int type, void *data, size_t datalen, int swap)
+/* If swap=1, data is in the non-native byte order */
     {
+    if(swap)
+        return UnpackSwapped(L, type, data, datalen);
     return Unpack_(L, type, data, datalen);
     }
 
@@ -0,0 +1,610 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Stefano Trettel
+ *
+ * Software repository: MoonGLMATH, https://github.com/stetre/moonglmath
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "internal.h"
+
+/* A DUAL QUATERNION is implemented as a table, with the elements in the array part:
+ * dq = { rw, rx, ry, rz, dw, dx, dy, dz }
+ * where r = (rw, rx, ry, rz) is the real part and d = (dw, dx, dy, dz) is the dual part.
+ *
+ * A unit dual quaternion represents the rigid transform 'rotate by r, then translate by t',
+ * with d = 0.5 * (0, t) * r.
+ */
+
+/*------------------------------------------------------------------------------*
+ | Check and push                                                               |
+ *------------------------------------------------------------------------------*/
+
+int testdualquat(lua_State *L, int arg, dualquat_t dq)
+/* Tests if the element at arg is a dual quaternion and sets dq accordingly
+ * (unless it is passed as 0).
+ */
+    {
+    size_t i;
+    if(typetag(L, arg) != TAG_DUALQUAT) return 0;
+
+    if(dq != NULL)
+        {
+        for(i=0; i < 8; i++)
+            {
+            lua_geti(L, arg, i+1);
+            dq[i] = luaL_checknumber(L, -1);
+            lua_pop(L, 1);
+            }
+        }
+    return 1;
+    }
+
+int checkdualquat(lua_State *L, int arg, dualquat_t dq)
+/* Same as testdualquat(), but raises a error if the test fails.
+ */
+    {
+    if(!testdualquat(L, arg, dq))
+        return luaL_argerror(L, arg, lua_pushfstring(L, "%s expected", DUALQUAT_MT));
+    return 1;
+    }
+
+int pushdualquat(lua_State *L, dualquat_t dq)
+    {
+    size_t i;
+    lua_newtable(L);
+    setmetatable(L, DUALQUAT_MT);
+    for(i=0; i<8; i++)
+        {
+        lua_pushnumber(L, dq[i]);
+        lua_seti(L, -2, i+1);
+        }
+    return 1;
+    }
+
+/*------------------------------------------------------------------------------*
+ | Non-Lua functions                                                            |
+ *------------------------------------------------------------------------------*/
+
+void dualquat_from_rt(dualquat_t dq, quat_t r, vec_t t)
+/* dq = (r, 0.5 * (0, t) * r) */
+    {
+    dq[0] = r[0]; dq[1] = r[1]; dq[2] = r[2]; dq[3] = r[3];
+    dq[4] = 0.5*(-t[0]*r[1] - t[1]*r[2] - t[2]*r[3]);
+    dq[5] = 0.5*( t[0]*r[0] + t[1]*r[3] - t[2]*r[2]);
+    dq[6] = 0.5*(-t[0]*r[3] + t[1]*r[0] + t[2]*r[1]);
+    dq[7] = 0.5*( t[0]*r[2] - t[1]*r[1] + t[2]*r[0]);
+    }
+
+void dualquat_to_rt(quat_t r, vec_t t, dualquat_t dq)
+/* Inverse of dualquat_from_rt(): r = real part, t = vector part of 2 * d * conj(r) 
+ * (dq is assumed to be normalized) */
+    {
+    double *d = dq + 4;
+    r[0] = dq[0]; r[1] = dq[1]; r[2] = dq[2]; r[3] = dq[3];
+    vec_clear(t);
+    t[0] = 2*(-d[0]*r[1] + d[1]*r[0] - d[2]*r[3] + d[3]*r[2]);
+    t[1] = 2*(-d[0]*r[2] + d[1]*r[3] + d[2]*r[0] - d[3]*r[1]);
+    t[2] = 2*(-d[0]*r[3] - d[1]*r[2] + d[2]*r[1] + d[3]*r[0]);
+    }
+
+void dualquat_mul(dualquat_t dst, dualquat_t a, dualquat_t b)
+/* dst = a * b = (ar * br, ar * bd + ad * br) (dst may overlap with a or b) */
+    {
+    quat_t r, d1, d2;
+    quat_mul(r, a, b);
+    quat_mul(d1, a, b + 4);
+    quat_mul(d2, a + 4, b);
+    dst[0] = r[0]; dst[1] = r[1]; dst[2] = r[2]; dst[3] = r[3];
+    dst[4] = d1[0] + d2[0]; dst[5] = d1[1] + d2[1];
+    dst[6] = d1[2] + d2[2]; dst[7] = d1[3] + d2[3];
+    }
+
+void dualquat_conj(dualquat_t dst, dualquat_t dq)
+/* Quaternion conjugate of both parts (for a unit dual quaternion, this is its inverse) */
+    {
+    dst[0] = dq[0]; dst[1] = -dq[1]; dst[2] = -dq[2]; dst[3] = -dq[3];
+    dst[4] = dq[4]; dst[5] = -dq[5]; dst[6] = -dq[6]; dst[7] = -dq[7];
+    }
+
+void dualquat_normalize(dualquat_t dq)
+/* In place. Normalizes the real part and removes from the dual part its component
+ * parallel to the real part, so that the result is a unit dual quaternion */
+    {
+    size_t i;
+    double n, k;
+    n = sqrt(dq[0]*dq[0] + dq[1]*dq[1] + dq[2]*dq[2] + dq[3]*dq[3]);
+    if(n == 0) return;
+    for(i = 0; i < 8; i++)
+        dq[i] /= n;
+    k = dq[0]*dq[4] + dq[1]*dq[5] + dq[2]*dq[6] + dq[3]*dq[7];
+    for(i = 0; i < 4; i++)
+        dq[i+4] -= k*dq[i];
+    }
+
+void dualquat_sclerp(dualquat_t dst, dualquat_t a, dualquat_t b, double t)
+/* Screw linear interpolation between the unit dual quaternions a and b.
+ * Rfr: B. Kenwright, "A Beginners Guide to Dual-Quaternions", WSCG 2012.
+ */
+    {
+    dualquat_t ac, bb, d, p;
+    double angle, pitch, s, sa, ca;
+    vec_t dir, mom;
+    size_t i;
+    dualquat_copy(bb, b);
+    if((a[0]*b[0] + a[1]*b[1] + a[2]*b[2] + a[3]*b[3]) < 0) /* take the shortest path */
+        for(i = 0; i < 8; i++) bb[i] = -bb[i];
+    dualquat_conj(ac, a);
+    dualquat_mul(d, ac, bb); /* d = a^-1 * b */
+    s = sqrt(d[1]*d[1] + d[2]*d[2] + d[3]*d[3]);
+    if(s < 1e-9) /* pure translation: interpolate it linearly */
+        {
+        p[0] = 1; p[1] = p[2] = p[3] = 0;
+        for(i = 4; i < 8; i++) p[i] = t * d[i];
+        }
+    else
+        {
+        /* screw parameters of d, scaled by t */
+        angle = 2*atan2(s, d[0]);
+        pitch = -2*d[4]/s;
+        for(i = 0; i < 3; i++)
+            {
+            dir[i] = d[i+1]/s;
+            mom[i] = (d[i+5] - dir[i]*pitch*0.5*d[0])/s;
+            }
+        angle *= t;
+        pitch *= t;
+        sa = sin(angle/2);
+        ca = cos(angle/2);
+        p[0] = ca;
+        p[4] = -pitch*0.5*sa;
+        for(i = 0; i < 3; i++)
+            {
+            p[i+1] = dir[i]*sa;
+            p[i+5] = mom[i]*sa + dir[i]*pitch*0.5*ca;
+            }
+        }
+    dualquat_mul(dst, a, p);
+    dualquat_normalize(dst);
+    }
+
+void dualquat_transform(vec_t dst, dualquat_t dq, vec_t p)
+/* Applies the rigid transform represented by the unit dual quaternion dq to the
+ * point p (dst may overlap with p) */
+    {
+    vec_t t, u, a, b;
+    quat_t r;
+    dualquat_to_rt(r, t, dq);
+    /* rotate: p' = p + 2*cross(rv, cross(rv, p) + w*p) */
+    u[0] = r[1]; u[1] = r[2]; u[2] = r[3];
+    vec_cross(a, u, p);
+    a[0] += r[0]*p[0]; a[1] += r[0]*p[1]; a[2] += r[0]*p[2];
+    vec_cross(b, u, a);
+    dst[0] = p[0] + 2*b[0] + t[0];
+    dst[1] = p[1] + 2*b[1] + t[1];
+    dst[2] = p[2] + 2*b[2] + t[2];
+    dst[3] = 0;
+    }
+
+/*------------------------------------------------------------------------------*
+ | DualQuat                                                                     |
+ *------------------------------------------------------------------------------*/
+
+static int DualQuat(lua_State *L)
+/* dualquat() -> identity
+ * dualquat(dq)
+ * dualquat(r, [t])
+ * dualquat(t)
+ * dualquat(mat4)
+ * dualquat(rw, rx, ry, rz, dw, dx, dy, dz)
+ */
+    {
+    dualquat_t dq;
+    quat_t r = { 1, 0, 0, 0 };
+    vec_t t;
+    mat_t m;
+    size_t i, nr, nc;
+    if(testdualquat(L, 1, dq))
+        return pushdualquat(L, dq);
+    if(testquat(L, 1, r) || testvec(L, 1, NULL, NULL, NULL))
+        {
+        vec_clear(t);
+        if(testvec(L, 1, t, NULL, NULL)) /* pure translation */
+            { r[0] = 1; r[1] = r[2] = r[3] = 0; }
+        else if(!lua_isnoneornil(L, 2))
+            checkvec(L, 2, t, NULL, NULL);
+        dualquat_from_rt(dq, r, t);
+        return pushdualquat(L, dq);
+        }
+    if(testmat(L, 1, m, &nr, &nc))
+        {
+        if((nr < 3) || (nc != 4))
+            return luaL_argerror(L, 1, "expected 4x4 or 3x4 matrix");
+        quat_frommat(r, m);
+        vec_clear(t);
+        t[0] = m[0][3]; t[1] = m[1][3]; t[2] = m[2][3];
+        dualquat_from_rt(dq, r, t);
+        return pushdualquat(L, dq);
+        }
+    if(lua_isnoneornil(L, 1))
+        {
+        dualquat_clear(dq);
+        dq[0] = 1;
+        return pushdualquat(L, dq);
+        }
+    for(i = 0; i < 8; i++)
+        dq[i] = luaL_optnumber(L, i+1, 0);
+    return pushdualquat(L, dq);
+    }
+
+static int IsDualQuat(lua_State *L)
+    {
+    lua_pushboolean(L, testdualquat(L, 1, NULL));
+    return 1;
+    }
+
+/*------------------------------------------------------------------------------*
+ | ToString                                                                     |
+ *------------------------------------------------------------------------------*/
+
+static int ToString_(lua_State *L, dualquat_t dq)
+/* With snprintf because lua_pushfstring does not support the %g conversion specifier */
+    {
+#define SZ 512
+#define space (SZ-p)
+    char str[SZ];
+    int p=0;
+    p = snprintf(str, space, "< "FMT", "FMT", "FMT", "FMT" >, < "FMT", "FMT", "FMT", "FMT" >", 
+                dq[0], dq[1], dq[2], dq[3], dq[4], dq[5], dq[6], dq[7]);
+    lua_pushlstring(L, str, p);
+    return 1;
+#undef space
+#undef SZ
+    }
+
+static int ToString(lua_State *L)
+    {
+    dualquat_t dq;
+    checkdualquat(L, 1, dq);
+    return ToString_(L, dq);
+    }
+
+static int Concat(lua_State *L)
+    {
+    dualquat_t dq;
+    if(testdualquat(L, 1, dq))
+        {
+        ToString_(L, dq);
+        lua_pushvalue(L, 2);
+        }
+    else if(testdualquat(L, 2, dq))
+        {
+        lua_pushvalue(L, 1);
+        ToString_(L, dq);
+        }
+    else 
+        return unexpected(L);
+    lua_concat(L, 2);
+    return 1;
+    }
+
+/*------------------------------------------------------------------------------*
+ | Metamethods                                                                  |
+ *------------------------------------------------------------------------------*/
+
+static int Unm(lua_State *L)
+    {
+    dualquat_t dq;
+    size_t i;
+    checkdualquat(L, 1, dq);
+    for(i=0; i < 8; i++)
+        dq[i] = -dq[i];
+    return pushdualquat(L, dq);
+    }
+
+static int Add(lua_State *L)
+    {
+    dualquat_t dq, dq1;
+    size_t i;
+    checkdualquat(L, 1, dq);
+    checkdualquat(L, 2, dq1);
+    for(i=0; i < 8; i++)
+        dq[i] += dq1[i];
+    return pushdualquat(L, dq);
+    }
+
+static int Sub(lua_State *L)
+    {
+    dualquat_t dq, dq1;
+    size_t i;
+    checkdualquat(L, 1, dq);
+    checkdualquat(L, 2, dq1);
+    for(i=0; i < 8; i++)
+        dq[i] -= dq1[i];
+    return pushdualquat(L, dq);
+    }
+
+static int Dxs(lua_State *L, int sarg, int dqarg)
+    {
+    dualquat_t dq;
+    size_t i;
+    double s = luaL_checknumber(L, sarg);
+    checkdualquat(L, dqarg, dq);
+    for(i=0; i < 8; i++)
+        dq[i] *= s;
+    return pushdualquat(L, dq);
+    }
+
+static int Mul(lua_State *L)
+    {
+    dualquat_t a, b;
+    vec_t v;
+    if(lua_isnumber(L, 1))
+        return Dxs(L, 1, 2);
+    if(lua_isnumber(L, 2))
+        return Dxs(L, 2, 1);
+    checkdualquat(L, 1, a);
+    if(testvec(L, 2, v, NULL, NULL))
+        {
+        dualquat_transform(v, a, v);
+        return pushvec(L, v, 3, 3, 0);
+        }
+    checkdualquat(L, 2, b);
+    dualquat_mul(a, a, b);
+    return pushdualquat(L, a);
+    }
+
+static int Div(lua_State *L)
+    {
+    dualquat_t dq;
+    size_t i;
+    double s;
+    checkdualquat(L, 1, dq);
+    s = luaL_checknumber(L, 2);
+    for(i=0; i < 8; i++)
+        dq[i] /= s;
+    return pushdualquat(L, dq);
+    }
+
+/*------------------------------------------------------------------------------*
+ | Functions and methods                                                        |
+ *------------------------------------------------------------------------------*/
+
+int dualquat_Parts(lua_State *L)
+    {
+    dualquat_t dq;
+    checkdualquat(L, 1, dq);
+    pushquat(L, dq);
+    pushquat(L, dq + 4);
+    return 2;
+    }
+
+int dualquat_Conj(lua_State *L)
+    {
+    dualquat_t dq;
+    checkdualquat(L, 1, dq);
+    dualquat_conj(dq, dq);
+    return pushdualquat(L, dq);
+    }
+
+int dualquat_Normalize(lua_State *L)
+    {
+    dualquat_t dq;
+    checkdualquat(L, 1, dq);
+    dualquat_normalize(dq);
+    return pushdualquat(L, dq);
+    }
+
+int dualquat_Sclerp(lua_State *L)
+    {
+    dualquat_t a, b, dq;
+    double t;
+    checkdualquat(L, 1, a);
+    checkdualquat(L, 2, b);
+    t = luaL_checknumber(L, 3);
+    dualquat_sclerp(dq, a, b, t);
+    return pushdualquat(L, dq);
+    }
+
+static int Rotation(lua_State *L)
+    {
+    dualquat_t dq;
+    checkdualquat(L, 1, dq);
+    return pushquat(L, dq);
+    }
+
+static int Translation(lua_State *L)
+    {
+    dualquat_t dq;
+    quat_t r;
+    vec_t t;
+    checkdualquat(L, 1, dq);
+    dualquat_to_rt(r, t, dq);
+    return pushvec(L, t, 3, 3, 0);
+    }
+
+static int Mat4(lua_State *L)
+    {
+    dualquat_t dq;
+    quat_t r;
+    vec_t t, s = { 1, 1, 1, 0 };
+    mat_t m;
+    checkdualquat(L, 1, dq);
+    dualquat_to_rt(r, t, dq);
+    compose_trs(m, t, r, s);
+    return pushmat(L, m, 4, 4, 4, 4);
+    }
+
+static int Transform(lua_State *L)
+    {
+    dualquat_t dq;
+    vec_t v;
+    checkdualquat(L, 1, dq);
+    checkvec(L, 2, v, NULL, NULL);
+    dualquat_transform(v, dq, v);
+    return pushvec(L, v, 3, 3, 0);
+    }
+
+/*------------------------------------------------------------------------------*
+ | Skinning                                                                     |
+ *------------------------------------------------------------------------------*/
+
+static size_t GetIndex(const char *p, int type, size_t i)
+/* Returns the i-th element of a packed array of integers of the given type */
+    {
+    switch(type)
+        {
+        case MOONGLMATH_TYPE_CHAR:   return (size_t)((int8_t*)p)[i];
+        case MOONGLMATH_TYPE_UCHAR:  return ((uint8_t*)p)[i];
+        case MOONGLMATH_TYPE_SHORT:  return (size_t)((int16_t*)p)[i];
+        case MOONGLMATH_TYPE_USHORT: return ((uint16_t*)p)[i];
+        case MOONGLMATH_TYPE_INT:    return (size_t)((int32_t*)p)[i];
+        case MOONGLMATH_TYPE_UINT:   return ((uint32_t*)p)[i];
+        case MOONGLMATH_TYPE_LONG:   return (size_t)((int64_t*)p)[i];
+        case MOONGLMATH_TYPE_ULONG:  return (size_t)((uint64_t*)p)[i];
+        default: return (size_t)-1;
+        }
+    return (size_t)-1;
+    }
+
+static int IsZero(dualquat_t dq)
+    {
+    return (dq[0] == 0) && (dq[1] == 0) && (dq[2] == 0) && (dq[3] == 0);
+    }
+
+static int Blend(lua_State *L, int skin)
+/* dq_blend(bones, joints, jointtype, weights, k, dst, [count], [type])
+ * dq_skin(bones, joints, jointtype, weights, k, src, dst, [count], [type])
+ */
+    {
+    size_t i, j, b, c, nbones, count, k;
+    char *bones, *joints, *weights, *dst, *src = NULL;
+    dualquat_t dq, bone, first;
+    double w;
+    vec_t v;
+    int has_first;
+    hostmem_t *bonesmem = checkhostmem(L, 1, NULL);
+    int jtype = checktype(L, 3);
+    lua_Integer k_ = luaL_checkinteger(L, 5);
+    int arg = skin ? 7 : 6; /* dst */
+    int type = checkrealtype(L, arg+2);
+    size_t sz = sizeoftype(type);
+    if((jtype == MOONGLMATH_TYPE_FLOAT) || (jtype == MOONGLMATH_TYPE_DOUBLE))
+        return luaL_argerror(L, 3, "integer type expected");
+    if(k_ < 1)
+        return luaL_argerror(L, 5, errstring(ERR_VALUE));
+    k = (size_t)k_;
+    bones = bonesmem->ptr;
+    nbones = bonesmem->size / (8 * sz);
+    dst = checkhostmemarray(L, arg, arg+1, (skin ? 3 : 8) * sz, &count);
+    weights = checkhostmemarray(L, 4, 0, k * sz, &count);
+    joints = checkhostmemarray(L, 2, 0, k * sizeoftype(jtype), &count);
+    if(skin)
+        src = checkhostmemarray(L, 6, 0, 3 * sz, &count);
+    for(i = 0; i < count; i++)
+        {
+        dualquat_clear(dq);
+        has_first = 0;
+        dualquat_clear(first);
+        for(j = 0; j < k; j++)
+            {
+            w = getreal(weights, type, i*k + j);
+            if(w == 0) continue;
+            b = GetIndex(joints, jtype, i*k + j);
+            if(b >= nbones)
+                return luaL_error(L, "joint index %d out of range (vertex %d)", (int)b, (int)(i+1));
+            for(c = 0; c < 8; c++)
+                bone[c] = getreal(bones, type, b*8 + c);
+            if(!has_first) /* first influence: reference for the hemisphere */
+                { dualquat_copy(first, bone); has_first = 1; }
+            else if((bone[0]*first[0] + bone[1]*first[1] + bone[2]*first[2] + bone[3]*first[3]) < 0)
+                w = -w; /* antipodal: blend along the shortest path */
+            for(c = 0; c < 8; c++)
+                dq[c] += w*bone[c];
+            }
+        if(IsZero(dq))
+            dq[0] = 1; /* no influences: identity */
+        dualquat_normalize(dq);
+        if(skin)
+            {
+            v[0] = getreal(src, type, 3*i);
+            v[1] = getreal(src, type, 3*i + 1);
+            v[2] = getreal(src, type, 3*i + 2);
+            dualquat_transform(v, dq, v);
+            setreal(dst, type, 3*i, v[0]);
+            setreal(dst, type, 3*i + 1, v[1]);
+            setreal(dst, type, 3*i + 2, v[2]);
+            }
+        else
+            for(c = 0; c < 8; c++)
+                setreal(dst, type, 8*i + c, dq[c]);
+        }
+    return 0;
+    }
+
+static int DqBlend(lua_State *L) { return Blend(L, 0); }
+static int DqSkin(lua_State *L) { return Blend(L, 1); }
+
+/*------------------------------------------------------------------------------*
+ | Registration                                                                 |
+ *------------------------------------------------------------------------------*/
+
+static const struct luaL_Reg Metamethods[] = 
+    {
+        { "__tostring", ToString },
+        { "__concat", Concat },
+        { "__unm", Unm },
+        { "__add", Add },
+        { "__sub", Sub },
+        { "__mul", Mul },
+        { "__div", Div },
+        { NULL, NULL } /* sentinel */
+    };
+
+static const struct luaL_Reg Methods[] = 
+    {
+        { "parts", dualquat_Parts },
+        { "conj", dualquat_Conj },
+        { "normalize", dualquat_Normalize },
+        { "sclerp", dualquat_Sclerp },
+        { "rotation", Rotation },
+        { "translation", Translation },
+        { "mat4", Mat4 },
+        { "transform", Transform },
+        { NULL, NULL } /* sentinel */
+    };
+
+static const struct luaL_Reg Functions[] = 
+    {
+        { "dualquat", DualQuat },
+        { "isdualquat", IsDualQuat },
+        { "dq_blend", DqBlend },
+        { "dq_skin", DqSkin },
+        { NULL, NULL } /* sentinel */
+    };
+
+void moonglmath_open_dualquat(lua_State *L)
+    {
+    newmetatable(L, DUALQUAT_MT);
+    settypetag(L, DUALQUAT_MT, TAG_DUALQUAT);
+    metatable_setfuncs(L, DUALQUAT_MT, Metamethods, Methods);
+    luaL_setfuncs(L, Functions, 0);
+    }
+
@@ -275,6 +275,7 @@ static int Enum(lua_State *L)
 #define CASE(xxx) if(strcmp(s, ""#xxx) == 0) return values##xxx(L)
     CASE(isrow);
     CASE(type);
+    CASE(endianness);
 #undef CASE
     return 0;
     }
@@ -309,6 +310,18 @@ void moonglmath_open_enums(lua_State *L)
     ADD(TYPE_ULONG, "ulong");
     ADD(TYPE_FLOAT, "float");
     ADD(TYPE_DOUBLE, "double");
+    ADD(TYPE_HALF, "half");
+    ADD(TYPE_SNORM8, "snorm8");
+    ADD(TYPE_UNORM8, "unorm8");
+    ADD(TYPE_SNORM16, "snorm16");
+    ADD(TYPE_UNORM16, "unorm16");
+    ADD(TYPE_SNORM_2_10_10_10, "snorm_2_10_10_10");
+    ADD(TYPE_UNORM_2_10_10_10, "unorm_2_10_10_10");
+
+    domain = DOMAIN_ENDIANNESS; 
+    ADD(ENDIANNESS_NATIVE, "native");
+    ADD(ENDIANNESS_LITTLE, "little");
+    ADD(ENDIANNESS_BIG, "big");
 #undef ADD
     }
 
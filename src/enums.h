@@ -46,6 +46,7 @@ void enums_freelist(lua_State *L, uint32_t *list);
 /* Enum domains */
 #define DOMAIN_ISROW                      0
 #define DOMAIN_TYPE                       1
+#define DOMAIN_ENDIANNESS                 2
 
 /* DOMAIN_ISROW values (vector type) */
 #define MOONGLMATH_COLUMN   0
@@ -62,6 +63,18 @@ void enums_freelist(lua_State *L, uint32_t *list);
 #define MOONGLMATH_TYPE_ULONG        8
 #define MOONGLMATH_TYPE_FLOAT        9
 #define MOONGLMATH_TYPE_DOUBLE       10
+#define MOONGLMATH_TYPE_HALF         11
+#define MOONGLMATH_TYPE_SNORM8       12
+#define MOONGLMATH_TYPE_UNORM8       13
+#define MOONGLMATH_TYPE_SNORM16      14
+#define MOONGLMATH_TYPE_UNORM16      15
+#define MOONGLMATH_TYPE_SNORM_2_10_10_10    16
+#define MOONGLMATH_TYPE_UNORM_2_10_10_10    17
+
+/* Byte order for glmath.pack() & friends */
+#define MOONGLMATH_ENDIANNESS_NATIVE    0
+#define MOONGLMATH_ENDIANNESS_LITTLE    1
+#define MOONGLMATH_ENDIANNESS_BIG       2
 
 #define testisrow(L, arg, err) (uint32_t)enums_test((L), DOMAIN_ISROW, (arg), (err))
 #define checkisrow(L, arg) (uint32_t)enums_check((L), DOMAIN_ISROW, (arg))
@@ -73,6 +86,11 @@ void enums_freelist(lua_State *L, uint32_t *list);
 #define pushtype(L, val) enums_push((L), DOMAIN_TYPE, (uint32_t)(val))
 #define valuestype(L) enums_values((L), DOMAIN_TYPE)
 
+#define testendianness(L, arg, err) (uint32_t)enums_test((L), DOMAIN_ENDIANNESS, (arg), (err))
+#define checkendianness(L, arg) (uint32_t)enums_check((L), DOMAIN_ENDIANNESS, (arg))
+#define pushendianness(L, val) enums_push((L), DOMAIN_ENDIANNESS, (uint32_t)(val))
+#define valuesendianness(L) enums_values((L), DOMAIN_ENDIANNESS)
+
 #if 0 /* scaffolding 6yy */
 #define testxxx(L, arg, err) (uint32_t)enums_test((L), DOMAIN_XXX, (arg), (err))
 #define checkxxx(L, arg) (uint32_t)enums_check((L), DOMAIN_XXX, (arg))
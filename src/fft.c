@@ -0,0 +1,331 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Stefano Trettel
+ *
+ * Software repository: MoonGLMATH, https://github.com/stetre/moonglmath
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "internal.h"
+
+/* Packed complex arrays: 
+ * a sequence of complex numbers, each stored as two consecutive real values (re, im),
+ * in a hostmem (see doc/hostmem.adoc, "Packed arrays").
+ */
+
+/*------------------------------------------------------------------------------*
+ | Mixed-radix FFT                                                              |
+ *------------------------------------------------------------------------------*/
+
+/* Decimation in time, with radix-4 and radix-2 butterflies for powers of 2 and a generic
+ * butterfly for other factors (the cost of which grows as the factor itself, so the
+ * transform is O(n log n) only for sizes with small prime factors).
+ * Rfr: M. Borgerding, "KISS FFT", https://github.com/mborgerding/kissfft
+ */
+
+#define MAXFACTORS 64
+#define TWO_PI 6.28318530717958647692
+
+typedef struct {
+    size_t n;
+    int inverse;
+    size_t factors[2*MAXFACTORS]; /* p1, m1, p2, m2, ..., with n = p1*m1, m1 = p2*m2, ... */
+    complex_t *tw; /* twiddles: tw[j] = exp(-+2*pi*i*j/n) */
+    complex_t *tmp; /* scratch for the generic butterfly */
+} plan_t;
+
+static size_t Factorize(size_t n, size_t *factors)
+/* Returns the largest factor */
+    {
+    size_t p = 4, maxp = 1;
+    double floor_sqrt = floor(sqrt((double)n));
+    do  {
+        while(n % p)
+            {
+            switch(p)
+                {
+                case 4: p = 2; break;
+                case 2: p = 3; break;
+                default: p += 2; break;
+                }
+            if(p > floor_sqrt) p = n; /* no more factors */
+            }
+        n /= p;
+        *factors++ = p;
+        *factors++ = n;
+        if(p > maxp) maxp = p;
+        } while(n > 1);
+    return maxp;
+    }
+
+static void Bfly2(complex_t *out, size_t fstride, const plan_t *plan, size_t m)
+    {
+    size_t k;
+    complex_t t, *out2 = out + m, *tw = plan->tw;
+    for(k = 0; k < m; k++)
+        {
+        t = out2[k] * tw[k*fstride];
+        out2[k] = out[k] - t;
+        out[k] += t;
+        }
+    }
+
+static void Bfly4(complex_t *out, size_t fstride, const plan_t *plan, size_t m)
+    {
+    size_t k;
+    complex_t s0, s1, s2, s3, s4, s5;
+    complex_t *tw = plan->tw;
+    for(k = 0; k < m; k++)
+        {
+        s0 = out[k + m] * tw[k*fstride];
+        s1 = out[k + 2*m] * tw[2*k*fstride];
+        s2 = out[k + 3*m] * tw[3*k*fstride];
+        s5 = out[k] - s1;
+        out[k] += s1;
+        s3 = s0 + s2;
+        s4 = s0 - s2;
+        out[k + 2*m] = out[k] - s3;
+        out[k] += s3;
+        if(plan->inverse)
+            {
+            out[k + m] = s5 + I*s4;
+            out[k + 3*m] = s5 - I*s4;
+            }
+        else
+            {
+            out[k + m] = s5 - I*s4;
+            out[k + 3*m] = s5 + I*s4;
+            }
+        }
+    }
+
+static void BflyGeneric(complex_t *out, size_t fstride, const plan_t *plan, size_t m, size_t p)
+    {
+    size_t u, q1, q, k, twidx;
+    complex_t t, *tmp = plan->tmp, *tw = plan->tw;
+    for(u = 0; u < m; u++)
+        {
+        for(q1 = 0, k = u; q1 < p; q1++, k += m)
+            tmp[q1] = out[k];
+        for(q1 = 0, k = u; q1 < p; q1++, k += m)
+            {
+            twidx = 0;
+            t = tmp[0];
+            for(q = 1; q < p; q++)
+                {
+                twidx += fstride*k;
+                if(twidx >= plan->n) twidx -= plan->n;
+                t += tmp[q] * tw[twidx];
+                }
+            out[k] = t;
+            }
+        }
+    }
+
+static void Work(complex_t *out, const complex_t *in, size_t fstride, const size_t *factors, const plan_t *plan)
+    {
+    size_t j, p = factors[0], m = factors[1];
+    if(m == 1)
+        {
+        for(j = 0; j < p; j++)
+            out[j] = in[j*fstride];
+        }
+    else
+        {
+        for(j = 0; j < p; j++)
+            Work(out + j*m, in + j*fstride, fstride*p, factors + 2, plan);
+        }
+    switch(p)
+        {
+        case 2: Bfly2(out, fstride, plan, m); break;
+        case 4: Bfly4(out, fstride, plan, m); break;
+        default: BflyGeneric(out, fstride, plan, m, p);
+        }
+    }
+
+static size_t Plan(plan_t *plan, size_t n, int inverse)
+/* Prepares the plan for a transform of size n >= 2, and returns the size of the
+ * workspace needed by Fft() (in complex elements) */
+    {
+    size_t maxp;
+    plan->n = n;
+    plan->inverse = inverse;
+    maxp = Factorize(n, plan->factors);
+    return 2*n + maxp; /* copy of the input, twiddles, and scratch */
+    }
+
+static void Fft(plan_t *plan, complex_t *x, complex_t *work)
+/* In place, unnormalized. work is the workspace (see Plan()) */
+    {
+    size_t j, n = plan->n;
+    double a;
+    complex_t *in = work;
+    plan->tw = in + n;
+    plan->tmp = plan->tw + n;
+    for(j = 0; j < n; j++)
+        {
+        a = (plan->inverse ? TWO_PI : -TWO_PI) * j / n;
+        plan->tw[j] = cos(a) + I*sin(a);
+        }
+    memcpy(in, x, n*sizeof(complex_t));
+    Work(x, in, 1, plan->factors, plan);
+    }
+
+/*------------------------------------------------------------------------------*
+ | Lua functions                                                                |
+ *------------------------------------------------------------------------------*/
+
+static int Transform(lua_State *L, int inverse)
+/* fft(data, [count], [type])
+ * ifft(data, [count], [type])
+ *
+ * The workspace and, for floats, the double copy of the data are allocated in a single
+ * block, and no Lua error can be raised before it is released.
+ */
+    {
+    size_t i, count, size;
+    plan_t plan;
+    complex_t *work, *z;
+    int type = checkrealtype(L, 3);
+    char *p = checkhostmemarray(L, 1, 2, 2*sizeoftype(type), &count);
+    if(count < 2) return 0; /* the transform of a single value is the value itself */
+    size = Plan(&plan, count, inverse);
+    if(type == MOONGLMATH_TYPE_DOUBLE)
+        {
+        work = (complex_t*)Malloc(L, size*sizeof(complex_t));
+        z = (complex_t*)p;
+        }
+    else
+        {
+        work = (complex_t*)Malloc(L, (size + count)*sizeof(complex_t));
+        z = work + size;
+        for(i = 0; i < count; i++)
+            z[i] = ((float*)p)[2*i] + I*((float*)p)[2*i+1];
+        }
+    Fft(&plan, z, work);
+    if(inverse)
+        for(i = 0; i < count; i++)
+            z[i] /= count;
+    if(type != MOONGLMATH_TYPE_DOUBLE)
+        for(i = 0; i < count; i++)
+            {
+            ((float*)p)[2*i] = (float)creal(z[i]);
+            ((float*)p)[2*i+1] = (float)cimag(z[i]);
+            }
+    Free(L, work);
+    return 0;
+    }
+
+static int FFT(lua_State *L) { return Transform(L, 0); }
+static int IFFT(lua_State *L) { return Transform(L, 1); }
+
+static int Mul(lua_State *L)
+/* carray_mul(a, b, dst, [count], [type]) */
+    {
+    size_t i, count;
+    complex_t za, zb;
+    char *a, *b, *dst;
+    int type = checkrealtype(L, 5);
+    size_t sz = 2*sizeoftype(type);
+    dst = checkhostmemarray(L, 3, 4, sz, &count);
+    a = checkhostmemarray(L, 1, 0, sz, &count);
+    b = checkhostmemarray(L, 2, 0, sz, &count);
+    for(i = 0; i < count; i++)
+        {
+        za = getreal(a, type, 2*i) + I*getreal(a, type, 2*i+1);
+        zb = getreal(b, type, 2*i) + I*getreal(b, type, 2*i+1);
+        za *= zb;
+        setreal(dst, type, 2*i, creal(za));
+        setreal(dst, type, 2*i+1, cimag(za));
+        }
+    return 0;
+    }
+
+static int Conj(lua_State *L)
+/* carray_conj(src, dst, [count], [type]) */
+    {
+    size_t i, count;
+    char *src, *dst;
+    int type = checkrealtype(L, 4);
+    size_t sz = 2*sizeoftype(type);
+    dst = checkhostmemarray(L, 2, 3, sz, &count);
+    src = checkhostmemarray(L, 1, 0, sz, &count);
+    for(i = 0; i < count; i++)
+        {
+        setreal(dst, type, 2*i, getreal(src, type, 2*i));
+        setreal(dst, type, 2*i+1, -getreal(src, type, 2*i+1));
+        }
+    return 0;
+    }
+
+static int Abs(lua_State *L)
+/* carray_abs(src, dst, [count], [type]) 
+ * dst is a packed array of reals */
+    {
+    size_t i, count;
+    char *src, *dst;
+    int type = checkrealtype(L, 4);
+    size_t sz = sizeoftype(type);
+    dst = checkhostmemarray(L, 2, 3, sz, &count);
+    src = checkhostmemarray(L, 1, 0, 2*sz, &count);
+    for(i = 0; i < count; i++)
+        setreal(dst, type, i, hypot(getreal(src, type, 2*i), getreal(src, type, 2*i+1)));
+    return 0;
+    }
+
+static int Exp(lua_State *L)
+/* carray_exp(src, dst, [count], [type]) */
+    {
+    size_t i, count;
+    complex_t z;
+    char *src, *dst;
+    int type = checkrealtype(L, 4);
+    size_t sz = 2*sizeoftype(type);
+    dst = checkhostmemarray(L, 2, 3, sz, &count);
+    src = checkhostmemarray(L, 1, 0, sz, &count);
+    for(i = 0; i < count; i++)
+        {
+        z = cexp(getreal(src, type, 2*i) + I*getreal(src, type, 2*i+1));
+        setreal(dst, type, 2*i, creal(z));
+        setreal(dst, type, 2*i+1, cimag(z));
+        }
+    return 0;
+    }
+
+/*------------------------------------------------------------------------------*
+ | Registration                                                                 |
+ *------------------------------------------------------------------------------*/
+
+static const struct luaL_Reg Functions[] = 
+    {
+        { "fft", FFT },
+        { "ifft", IFFT },
+        { "carray_mul", Mul },
+        { "carray_conj", Conj },
+        { "carray_abs", Abs },
+        { "carray_exp", Exp },
+        { NULL, NULL } /* sentinel */
+    };
+
+void moonglmath_open_fft(lua_State *L)
+    {
+    luaL_setfuncs(L, Functions, 0);
+    }
+
@@ -31,136 +31,237 @@
 
 #define badarg(L, arg) luaL_argerror((L), (arg), "invalid argument type")
 
+/* Polymorphic functions dispatch on the type tag of their first argument (see typetag()),
+ * which takes a single metatable lookup whatever the number of candidate types.
+ */
+
 static int Det(lua_State *L)
     {
-    if(ismat(L,1)) return mat_Det(L);
+    if(typetag(L, 1) == TAG_MAT) return mat_Det(L);
     return badarg(L, 1);
     }
 
 static int Adj(lua_State *L)
     {
-    if(ismat(L,1)) return mat_Adj(L);
+    if(typetag(L, 1) == TAG_MAT) return mat_Adj(L);
     return badarg(L, 1);
     }
 
 static int Inv(lua_State *L)
     {
-    if(ismat(L,1)) return mat_Inv(L);
-    if(isquat(L,1)) return quat_Inv(L);
-    if(iscomplex(L,1)) return complex_Inv(L);
+    switch(typetag(L, 1))
+        {
+        case TAG_MAT: return mat_Inv(L);
+        case TAG_QUAT: return quat_Inv(L);
+        case TAG_COMPLEX: return complex_Inv(L);
+        default: return badarg(L, 1);
+        }
+    }
+
+static int AffineInv(lua_State *L)
+    {
+    if(typetag(L, 1) == TAG_MAT) return mat_AffineInv(L);
     return badarg(L, 1);
     }
 
+static int RigidInv(lua_State *L)
+    {
+    if(typetag(L, 1) == TAG_MAT) return mat_RigidInv(L);
+    return badarg(L, 1);
+    }
 
-static int Norm(lua_State *L)
+static int AffineMul(lua_State *L)
     {
-    if(isvec(L,1)) return vec_Norm(L);
-    if(isquat(L,1)) return quat_Norm(L);
-    if(iscomplex(L,1)) return complex_Norm(L);
+    if(typetag(L, 1) == TAG_MAT) return mat_AffineMul(L);
     return badarg(L, 1);
     }
 
+static int IsAffine(lua_State *L)
+    {
+    if(typetag(L, 1) == TAG_MAT) return mat_IsAffine(L);
+    lua_pushboolean(L, 0);
+    return 1;
+    }
+
+static int Norm(lua_State *L)
+    {
+    switch(typetag(L, 1))
+        {
+        case TAG_VEC: return vec_Norm(L);
+        case TAG_QUAT: return quat_Norm(L);
+        case TAG_COMPLEX: return complex_Norm(L);
+        default: return badarg(L, 1);
+        }
+    }
+
 static int Norm2(lua_State *L)
     {
-    if(isvec(L,1)) return vec_Norm2(L);
-    if(isquat(L,1)) return quat_Norm2(L);
-    if(iscomplex(L,1)) return complex_Norm2(L);
-    return badarg(L, 1);
+    switch(typetag(L, 1))
+        {
+        case TAG_VEC: return vec_Norm2(L);
+        case TAG_QUAT: return quat_Norm2(L);
+        case TAG_COMPLEX: return complex_Norm2(L);
+        default: return badarg(L, 1);
+        }
     }
 
 static int Conj(lua_State *L)
     {
-    if(isquat(L,1)) return quat_Conj(L);
-    if(iscomplex(L,1)) return complex_Conj(L);
-    return badarg(L, 1);
+    switch(typetag(L, 1))
+        {
+        case TAG_QUAT: return quat_Conj(L);
+        case TAG_COMPLEX: return complex_Conj(L);
+        case TAG_DUALQUAT: return dualquat_Conj(L);
+        default: return badarg(L, 1);
+        }
     }
 
 static int Parts(lua_State *L)
     {
-    if(isquat(L,1)) return quat_Parts(L);
-    if(iscomplex(L,1)) return complex_Parts(L);
-    return badarg(L, 1);
+    switch(typetag(L, 1))
+        {
+        case TAG_QUAT: return quat_Parts(L);
+        case TAG_COMPLEX: return complex_Parts(L);
+        case TAG_DUALQUAT: return dualquat_Parts(L);
+        default: return badarg(L, 1);
+        }
     }
 
 static int Normalize(lua_State *L)
     {
-    if(isvec(L,1)) return vec_Normalize(L);
-    if(isquat(L,1)) return quat_Normalize(L);
-    if(iscomplex(L,1)) return complex_Normalize(L);
-    return badarg(L, 1);
+    switch(typetag(L, 1))
+        {
+        case TAG_VEC: return vec_Normalize(L);
+        case TAG_QUAT: return quat_Normalize(L);
+        case TAG_COMPLEX: return complex_Normalize(L);
+        case TAG_DUALQUAT: return dualquat_Normalize(L);
+        default: return badarg(L, 1);
+        }
     }
 
 
 static int Trace(lua_State *L)
     {
-    if(ismat(L,1)) return mat_Trace(L);
+    if(typetag(L, 1) == TAG_MAT) return mat_Trace(L);
     return badarg(L, 1);
     }
 
 static int Transpose(lua_State *L)
     {
-    if(isvec(L,1)) return vec_Transpose(L);
-    if(ismat(L,1)) return mat_Transpose(L);
-    return badarg(L, 1);
+    switch(typetag(L, 1))
+        {
+        case TAG_VEC: return vec_Transpose(L);
+        case TAG_MAT: return mat_Transpose(L);
+        default: return badarg(L, 1);
+        }
     }
 
 static int Row(lua_State *L)
     {
-    if(ismat(L,1)) return mat_Row(L);
+    if(typetag(L, 1) == TAG_MAT) return mat_Row(L);
     return badarg(L, 1);
     }
 
 static int Column(lua_State *L)
     {
-    if(ismat(L,1)) return mat_Column(L);
+    if(typetag(L, 1) == TAG_MAT) return mat_Column(L);
     return badarg(L, 1);
     }
 
 static int Clamp(lua_State *L)
     {
     if(lua_isnumber(L,1)) return num_Clamp(L);
-    if(isvec(L,1)) return vec_Clamp(L);
-    if(ismat(L,1)) return mat_Clamp(L);
-    return badarg(L, 1);
+    switch(typetag(L, 1))
+        {
+        case TAG_VEC: return vec_Clamp(L);
+        case TAG_MAT: return mat_Clamp(L);
+        default: return badarg(L, 1);
+        }
     }
 
 static int Mix(lua_State *L)
     {
     if(lua_isnumber(L,1)) return num_Mix(L);
-    if(isvec(L,1)) return vec_Mix(L);
-    if(ismat(L,1)) return mat_Mix(L);
-    if(isquat(L,1)) return quat_Mix(L);
-    return badarg(L, 1);
+    switch(typetag(L, 1))
+        {
+        case TAG_VEC: return vec_Mix(L);
+        case TAG_MAT: return mat_Mix(L);
+        case TAG_QUAT: return quat_Mix(L);
+        default: return badarg(L, 1);
+        }
     }
 
 static int Slerp(lua_State *L)
     {
-    if(isquat(L,1)) return quat_Slerp(L);
+    if(typetag(L, 1) == TAG_QUAT) return quat_Slerp(L);
+    return badarg(L, 1);
+    }
+
+static int FastNormalize(lua_State *L)
+    {
+    switch(typetag(L, 1))
+        {
+        case TAG_VEC: return vec_FastNormalize(L);
+        case TAG_QUAT: return quat_FastNormalize(L);
+        default: return badarg(L, 1);
+        }
+    }
+
+static int FastRsqrt(lua_State *L)
+    {
+    if(lua_isnumber(L,1)) return num_FastRsqrt(L);
+    return badarg(L, 1);
+    }
+
+static int Nlerp(lua_State *L)
+    {
+    if(typetag(L, 1) == TAG_QUAT) return quat_Nlerp(L);
+    return badarg(L, 1);
+    }
+
+static int FastSlerp(lua_State *L)
+    {
+    if(typetag(L, 1) == TAG_QUAT) return quat_FastSlerp(L);
+    return badarg(L, 1);
+    }
+
+static int Sclerp(lua_State *L)
+    {
+    if(typetag(L, 1) == TAG_DUALQUAT) return dualquat_Sclerp(L);
     return badarg(L, 1);
     }
 
 static int Step(lua_State *L)
     {
     if(lua_isnumber(L,1)) return num_Step(L);
-    if(isvec(L,1)) return vec_Step(L);
-    if(ismat(L,1)) return mat_Step(L);
-    return badarg(L, 1);
+    switch(typetag(L, 1))
+        {
+        case TAG_VEC: return vec_Step(L);
+        case TAG_MAT: return mat_Step(L);
+        default: return badarg(L, 1);
+        }
     }
 
 static int Smoothstep(lua_State *L)
     {
     if(lua_isnumber(L,1)) return num_Smoothstep(L);
-    if(isvec(L,1)) return vec_Smoothstep(L);
-    if(ismat(L,1)) return mat_Smoothstep(L);
-    return badarg(L, 1);
+    switch(typetag(L, 1))
+        {
+        case TAG_VEC: return vec_Smoothstep(L);
+        case TAG_MAT: return mat_Smoothstep(L);
+        default: return badarg(L, 1);
+        }
     }
 
 static int Fade(lua_State *L)
     {
     if(lua_isnumber(L,1)) return num_Fade(L);
-    if(isvec(L,1)) return vec_Fade(L);
-    if(ismat(L,1)) return mat_Fade(L);
-    return badarg(L, 1);
+    switch(typetag(L, 1))
+        {
+        case TAG_VEC: return vec_Fade(L);
+        case TAG_MAT: return mat_Fade(L);
+        default: return badarg(L, 1);
+        }
     }
 
 /*------------------------------------------------------------------------------*
@@ -172,11 +273,17 @@ static const struct luaL_Reg Functions[] =
         { "adj", Adj },
         { "det", Det },
         { "inv", Inv },
+        { "affine_inv", AffineInv },
+        { "rigid_inv", RigidInv },
+        { "affine_mul", AffineMul },
+        { "isaffine", IsAffine },
         { "norm", Norm },
         { "norm2", Norm2 },
         { "conj", Conj },
         { "parts", Parts },
         { "normalize", Normalize },
+        { "fast_normalize", FastNormalize },
+        { "fast_rsqrt", FastRsqrt },
         { "trace", Trace },
         { "transpose", Transpose },
         { "row", Row },
@@ -184,6 +291,9 @@ static const struct luaL_Reg Functions[] =
         { "clamp", Clamp },
         { "mix", Mix },
         { "slerp", Slerp },
+        { "nlerp", Nlerp },
+        { "fast_slerp", FastSlerp },
+        { "sclerp", Sclerp },
         { "step", Step },
         { "smoothstep", Smoothstep },
         { "fade", Fade },
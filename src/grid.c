@@ -0,0 +1,702 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Stefano Trettel
+ *
+ * Software repository: MoonGLMATH, https://github.com/stetre/moonglmath
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "internal.h"
+
+/* Spatial hash grid.
+ *
+ * The space is partitioned in cubic cells of side 'cellsize', and each object (a point or
+ * an axis aligned box, identified by an integer id) is listed in all the cells it overlaps.
+ * Cells are created on demand and located via a hash table keyed on their packed integer
+ * coordinates, so that only the occupied cells use memory (a cell that becomes empty is
+ * removed, and its slot is filled with the last cell, so cells[] stays dense).
+ * Objects are located by id via a second hash table, so that insert, remove and move are
+ * O(1) (for objects spanning a bounded number of cells). Objects spanning more than
+ * MAXSPAN cells are listed in a single 'overflow' cell instead, which is visited by all
+ * the queries.
+ */
+
+#define NONE ((uint32_t)-1)
+#define MAXCOORD 1048575 /* 2^20-1, so that cell coordinates fit in 21 bits */
+#define MAXSPAN 512
+
+typedef struct { /* open addressing hash table (linear probing), uint64_t -> uint32_t */
+    uint64_t *keys;
+    uint32_t *vals; /* NONE = free slot */
+    size_t cap; /* no. of slots (a power of 2) */
+    size_t count; /* no. of used slots */
+} hashmap_t;
+
+typedef struct {
+    lua_Integer id;
+    box_t box; /* bounds (minx, maxx, miny, maxy, minz, maxz) */
+    int32_t cmin[3], cmax[3]; /* range of the covered cells */
+    uint32_t stamp; /* stamp of the last query that visited the entry */
+    uint32_t next; /* next entry in the free list */
+} entry_t;
+
+typedef struct {
+    uint64_t key; /* key in the cell map */
+    uint32_t *items; /* entries listed in the cell */
+    uint32_t count, cap;
+} cell_t;
+
+struct moonglmath_grid_s {
+    double cellsize;
+    hashmap_t cellmap; /* cell key -> index in cells[] */
+    hashmap_t idmap; /* object id -> index in entries[] */
+    cell_t *cells; /* cells[0] is the overflow cell */
+    uint32_t ncells, cellscap;
+    entry_t *entries;
+    uint32_t nentries, entriescap;
+    uint32_t freelist; /* first free entry, or NONE */
+    uint32_t count; /* no. of objects */
+    uint32_t stamp; /* current query stamp */
+};
+
+/*------------------------------------------------------------------------------*
+ | Hash table                                                                   |
+ *------------------------------------------------------------------------------*/
+
+static size_t Hash(uint64_t key, size_t cap)
+    {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return (size_t)key & (cap - 1);
+    }
+
+static void hashmap_init(lua_State *L, hashmap_t *map, size_t cap)
+    {
+    map->keys = (uint64_t*)Malloc(L, cap * sizeof(uint64_t));
+    map->vals = (uint32_t*)Malloc(L, cap * sizeof(uint32_t));
+    memset(map->vals, 0xff, cap * sizeof(uint32_t));
+    map->cap = cap;
+    map->count = 0;
+    }
+
+static void hashmap_free(lua_State *L, hashmap_t *map)
+    {
+    Free(L, map->keys);
+    Free(L, map->vals);
+    map->keys = NULL;
+    map->vals = NULL;
+    map->cap = map->count = 0;
+    }
+
+static void hashmap_reset(hashmap_t *map)
+    {
+    memset(map->vals, 0xff, map->cap * sizeof(uint32_t));
+    map->count = 0;
+    }
+
+static uint32_t hashmap_get(hashmap_t *map, uint64_t key)
+    {
+    size_t i = Hash(key, map->cap);
+    while(map->vals[i] != NONE)
+        {
+        if(map->keys[i] == key) return map->vals[i];
+        i = (i + 1) & (map->cap - 1);
+        }
+    return NONE;
+    }
+
+static void hashmap_put(lua_State *L, hashmap_t *map, uint64_t key, uint32_t val)
+/* key must not be already present */
+    {
+    size_t i, j;
+    hashmap_t old;
+    if(2*(map->count + 1) > map->cap) /* keep the load factor below 1/2 */
+        {
+        old = *map;
+        hashmap_init(L, map, 2*old.cap);
+        for(j = 0; j < old.cap; j++)
+            if(old.vals[j] != NONE) hashmap_put(L, map, old.keys[j], old.vals[j]);
+        hashmap_free(L, &old);
+        }
+    i = Hash(key, map->cap);
+    while(map->vals[i] != NONE)
+        i = (i + 1) & (map->cap - 1);
+    map->keys[i] = key;
+    map->vals[i] = val;
+    map->count++;
+    }
+
+static void hashmap_set(hashmap_t *map, uint64_t key, uint32_t val)
+/* key must be present */
+    {
+    size_t i = Hash(key, map->cap);
+    while(map->keys[i] != key || map->vals[i] == NONE)
+        i = (i + 1) & (map->cap - 1);
+    map->vals[i] = val;
+    }
+
+static void hashmap_del(hashmap_t *map, uint64_t key)
+/* Removes key, shifting back the following entries of its cluster (no tombstones) */
+    {
+    size_t i, j, h, mask = map->cap - 1;
+    i = Hash(key, map->cap);
+    while(map->vals[i] != NONE)
+        {
+        if(map->keys[i] == key) break;
+        i = (i + 1) & mask;
+        }
+    if(map->vals[i] == NONE) return; /* not present */
+    j = i;
+    while(1)
+        {
+        map->vals[i] = NONE;
+        do  {
+            j = (j + 1) & mask;
+            if(map->vals[j] == NONE) { map->count--; return; }
+            h = Hash(map->keys[j], map->cap);
+            } while((i <= j) ? ((i < h) && (h <= j)) : ((i < h) || (h <= j)));
+        map->keys[i] = map->keys[j];
+        map->vals[i] = map->vals[j];
+        i = j;
+        }
+    }
+
+/*------------------------------------------------------------------------------*
+ | Cells and entries                                                            |
+ *------------------------------------------------------------------------------*/
+
+static int32_t CellCoord(grid_t *grid, double x)
+    {
+    double c = floor(x / grid->cellsize);
+    if(c != c) return 0; /* NaN */
+    if(c < -MAXCOORD) return -MAXCOORD;
+    if(c > MAXCOORD) return MAXCOORD;
+    return (int32_t)c;
+    }
+
+static uint64_t CellKey(int32_t i, int32_t j, int32_t k)
+    {
+    return ((uint64_t)(i & 0x1fffff) << 42) | ((uint64_t)(j & 0x1fffff) << 21) | 
+            (uint64_t)(k & 0x1fffff);
+    }
+
+static uint32_t GetCell(lua_State *L, grid_t *grid, int32_t i, int32_t j, int32_t k)
+/* Returns the index of the cell, creating it if needed */
+    {
+    uint64_t key = CellKey(i, j, k);
+    uint32_t c = hashmap_get(&grid->cellmap, key);
+    if(c != NONE) return c;
+    if(grid->ncells == grid->cellscap)
+        {
+        grid->cells = (cell_t*)Realloc(L, grid->cells, grid->cellscap * sizeof(cell_t),
+                            2 * grid->cellscap * sizeof(cell_t));
+        grid->cellscap *= 2;
+        }
+    c = grid->ncells;
+    hashmap_put(L, &grid->cellmap, key, c);
+    grid->cells[c].key = key;
+    grid->ncells++;
+    return c;
+    }
+
+static void DropCell(grid_t *grid, uint32_t c)
+/* Removes the (empty) cell c, moving the last cell in its slot. The items buffer of
+ * the removed cell is kept at the end of cells[], for reuse by the next new cell. */
+    {
+    cell_t tmp;
+    uint32_t last = grid->ncells - 1;
+    hashmap_del(&grid->cellmap, grid->cells[c].key);
+    if(c != last)
+        {
+        tmp = grid->cells[c];
+        grid->cells[c] = grid->cells[last];
+        grid->cells[last] = tmp;
+        hashmap_set(&grid->cellmap, grid->cells[c].key, c);
+        }
+    grid->ncells--;
+    }
+
+static void CellAdd(lua_State *L, cell_t *cell, uint32_t e)
+    {
+    uint32_t cap;
+    if(cell->count == cell->cap)
+        {
+        cap = cell->cap == 0 ? 4 : 2 * cell->cap;
+        cell->items = (uint32_t*)Realloc(L, cell->items, cell->cap * sizeof(uint32_t),
+                            cap * sizeof(uint32_t));
+        cell->cap = cap;
+        }
+    cell->items[cell->count++] = e;
+    }
+
+static void CellRemove(cell_t *cell, uint32_t e)
+    {
+    uint32_t i;
+    for(i = 0; i < cell->count; i++)
+        {
+        if(cell->items[i] == e)
+            {
+            cell->items[i] = cell->items[--cell->count];
+            return;
+            }
+        }
+    }
+
+static int Oversized(entry_t *entry)
+    {
+    double span = 1;
+    int i;
+    for(i = 0; i < 3; i++)
+        span *= (double)entry->cmax[i] - entry->cmin[i] + 1;
+    return span > MAXSPAN;
+    }
+
+static void SetBounds(grid_t *grid, entry_t *entry, box_t b)
+    {
+    int i;
+    memcpy(entry->box, b, sizeof(box_t));
+    for(i = 0; i < 3; i++)
+        {
+        entry->cmin[i] = CellCoord(grid, b[2*i]);
+        entry->cmax[i] = CellCoord(grid, b[2*i+1]);
+        }
+    }
+
+static void Link(lua_State *L, grid_t *grid, uint32_t e)
+/* Lists the entry in the cells it overlaps */
+    {
+    int32_t i, j, k;
+    uint32_t c;
+    entry_t *entry = &grid->entries[e];
+    if(Oversized(entry))
+        { CellAdd(L, &grid->cells[0], e); return; }
+    for(i = entry->cmin[0]; i <= entry->cmax[0]; i++)
+        for(j = entry->cmin[1]; j <= entry->cmax[1]; j++)
+            for(k = entry->cmin[2]; k <= entry->cmax[2]; k++)
+                {
+                c = GetCell(L, grid, i, j, k);
+                CellAdd(L, &grid->cells[c], e);
+                }
+    }
+
+static void Unlink(grid_t *grid, uint32_t e)
+    {
+    int32_t i, j, k;
+    uint32_t c;
+    entry_t *entry = &grid->entries[e];
+    if(Oversized(entry))
+        { CellRemove(&grid->cells[0], e); return; }
+    for(i = entry->cmin[0]; i <= entry->cmax[0]; i++)
+        for(j = entry->cmin[1]; j <= entry->cmax[1]; j++)
+            for(k = entry->cmin[2]; k <= entry->cmax[2]; k++)
+                {
+                c = hashmap_get(&grid->cellmap, CellKey(i, j, k));
+                if(c == NONE) continue;
+                CellRemove(&grid->cells[c], e);
+                if(grid->cells[c].count == 0) DropCell(grid, c);
+                }
+    }
+
+static int Insert_(lua_State *L, grid_t *grid, lua_Integer id, box_t b)
+/* Returns ERR_VALUE if id is already in use */
+    {
+    uint32_t e;
+    entry_t *entry;
+    if(hashmap_get(&grid->idmap, (uint64_t)id) != NONE)
+        return ERR_VALUE;
+    if(grid->freelist != NONE)
+        {
+        e = grid->freelist;
+        grid->freelist = grid->entries[e].next;
+        }
+    else
+        {
+        if(grid->nentries == grid->entriescap)
+            {
+            grid->entries = (entry_t*)Realloc(L, grid->entries, grid->entriescap * sizeof(entry_t),
+                            2 * grid->entriescap * sizeof(entry_t));
+            grid->entriescap *= 2;
+            }
+        e = grid->nentries++;
+        }
+    entry = &grid->entries[e];
+    entry->id = id;
+    entry->stamp = 0;
+    entry->next = NONE;
+    SetBounds(grid, entry, b);
+    hashmap_put(L, &grid->idmap, (uint64_t)id, e);
+    Link(L, grid, e);
+    grid->count++;
+    return 0;
+    }
+
+static void Move_(lua_State *L, grid_t *grid, lua_Integer id, box_t b)
+/* Moves the object, inserting it if it is not in the grid */
+    {
+    entry_t tmp, *entry;
+    uint32_t e = hashmap_get(&grid->idmap, (uint64_t)id);
+    if(e == NONE)
+        { Insert_(L, grid, id, b); return; }
+    entry = &grid->entries[e];
+    SetBounds(grid, &tmp, b);
+    if((memcmp(tmp.cmin, entry->cmin, sizeof(tmp.cmin)) == 0) && 
+            (memcmp(tmp.cmax, entry->cmax, sizeof(tmp.cmax)) == 0))
+        { /* still in the same cells */
+        memcpy(entry->box, b, sizeof(box_t));
+        return; 
+        }
+    Unlink(grid, e);
+    SetBounds(grid, entry, b);
+    Link(L, grid, e);
+    }
+
+static int Remove_(grid_t *grid, lua_Integer id)
+/* Returns 1 if the object was removed, 0 if it was not in the grid */
+    {
+    uint32_t e = hashmap_get(&grid->idmap, (uint64_t)id);
+    if(e == NONE) return 0;
+    Unlink(grid, e);
+    hashmap_del(&grid->idmap, (uint64_t)id);
+    grid->entries[e].next = grid->freelist;
+    grid->freelist = e;
+    grid->count--;
+    return 1;
+    }
+
+static void Clear_(grid_t *grid)
+    {
+    uint32_t c;
+    for(c = 0; c < grid->ncells; c++)
+        grid->cells[c].count = 0;
+    grid->ncells = 1; /* the overflow cell is always there */
+    hashmap_reset(&grid->cellmap);
+    hashmap_reset(&grid->idmap);
+    grid->nentries = 0;
+    grid->freelist = NONE;
+    grid->count = 0;
+    }
+
+/*------------------------------------------------------------------------------*
+ | Queries                                                                      |
+ *------------------------------------------------------------------------------*/
+
+static int Overlaps(box_t a, box_t b)
+    {
+    return (a[0] <= b[1]) && (b[0] <= a[1]) && (a[2] <= b[3]) && (b[2] <= a[3]) &&
+           (a[4] <= b[5]) && (b[4] <= a[5]);
+    }
+
+static int InSphere(box_t b, vec_t c, double r2)
+/* Checks if the box b intersects the sphere with center c and squared radius r2 */
+    {
+    double d, d2 = 0;
+    int i;
+    for(i = 0; i < 3; i++)
+        {
+        if(c[i] < b[2*i]) d = b[2*i] - c[i];
+        else if(c[i] > b[2*i+1]) d = c[i] - b[2*i+1];
+        else continue;
+        d2 += d*d;
+        }
+    return d2 <= r2;
+    }
+
+static void VisitCell(lua_State *L, grid_t *grid, cell_t *cell, box_t qb, vec_t c, double r2, 
+            lua_Integer *n)
+    {
+    uint32_t i;
+    entry_t *entry;
+    for(i = 0; i < cell->count; i++)
+        {
+        entry = &grid->entries[cell->items[i]];
+        if(entry->stamp == grid->stamp) continue; /* already visited */
+        entry->stamp = grid->stamp;
+        if(!Overlaps(entry->box, qb)) continue;
+        if(c && !InSphere(entry->box, c, r2)) continue;
+        lua_pushinteger(L, entry->id);
+        lua_rawseti(L, -2, ++(*n));
+        }
+    }
+
+static int Query(lua_State *L, grid_t *grid, box_t qb, vec_t c, double r2)
+/* Pushes a table with the ids of the objects overlapping the box qb (and the sphere
+ * (c, r2), if c is not NULL).
+ */
+    {
+    int32_t cmin[3], cmax[3], i, j, k;
+    uint32_t cell;
+    double span = 1;
+    lua_Integer n = 0;
+
+    if(++grid->stamp == 0) /* wrapped around: reset the stamps */
+        {
+        for(cell = 0; cell < grid->nentries; cell++)
+            grid->entries[cell].stamp = 0;
+        grid->stamp = 1;
+        }
+
+    lua_newtable(L);
+    for(i = 0; i < 3; i++)
+        {
+        cmin[i] = CellCoord(grid, qb[2*i]);
+        cmax[i] = CellCoord(grid, qb[2*i+1]);
+        span *= (double)cmax[i] - cmin[i] + 1;
+        }
+    VisitCell(L, grid, &grid->cells[0], qb, c, r2, &n);
+    if(span >= grid->ncells) /* cheaper to visit all the existing cells */
+        {
+        for(cell = 1; cell < grid->ncells; cell++)
+            VisitCell(L, grid, &grid->cells[cell], qb, c, r2, &n);
+        return 1;
+        }
+    for(i = cmin[0]; i <= cmax[0]; i++)
+        for(j = cmin[1]; j <= cmax[1]; j++)
+            for(k = cmin[2]; k <= cmax[2]; k++)
+                {
+                cell = hashmap_get(&grid->cellmap, CellKey(i, j, k));
+                if(cell != NONE) 
+                    VisitCell(L, grid, &grid->cells[cell], qb, c, r2, &n);
+                }
+    return 1;
+    }
+
+/*------------------------------------------------------------------------------*
+ | Grid                                                                         |
+ *------------------------------------------------------------------------------*/
+
+static int freegrid(lua_State *L, ud_t *ud)
+    {
+    uint32_t c;
+    grid_t *grid = (grid_t*)ud->handle;
+    if(!freeuserdata(L, ud, "grid")) return 0;
+    for(c = 0; c < grid->cellscap; c++)
+        Free(L, grid->cells[c].items);
+    Free(L, grid->cells);
+    Free(L, grid->entries);
+    hashmap_free(L, &grid->cellmap);
+    hashmap_free(L, &grid->idmap);
+    Free(L, grid);
+    return 0;
+    }
+
+static int Create(lua_State *L)
+    {
+    ud_t *ud;
+    grid_t *grid;
+    double cellsize = luaL_checknumber(L, 1);
+    if(!(cellsize > 0))
+        return luaL_argerror(L, 1, errstring(ERR_VALUE));
+    grid = (grid_t*)Malloc(L, sizeof(grid_t));
+    grid->cellsize = cellsize;
+    hashmap_init(L, &grid->cellmap, 64);
+    hashmap_init(L, &grid->idmap, 64);
+    grid->cellscap = 32;
+    grid->cells = (cell_t*)Malloc(L, grid->cellscap * sizeof(cell_t));
+    grid->ncells = 1;
+    grid->entriescap = 32;
+    grid->entries = (entry_t*)Malloc(L, grid->entriescap * sizeof(entry_t));
+    grid->freelist = NONE;
+    ud = newuserdata(L, grid, GRID_MT, "grid");
+    ud->destructor = freegrid;
+    return 1;
+    }
+
+static void CheckObject(lua_State *L, int arg, box_t b)
+/* Checks for a point (vec2|vec3) or a box (box2|box3), and stores its bounds in b */
+    {
+    vec_t v;
+    if(testvec(L, arg, v, NULL, NULL))
+        {
+        b[0] = b[1] = v[0];
+        b[2] = b[3] = v[1];
+        b[4] = b[5] = v[2];
+        return;
+        }
+    if(testbox(L, arg, b, NULL))
+        return;
+    luaL_argerror(L, arg, "vec or box expected");
+    }
+
+static int Insert(lua_State *L)
+    {
+    box_t b;
+    grid_t *grid = checkgrid(L, 1, NULL);
+    lua_Integer id = luaL_checkinteger(L, 2);
+    CheckObject(L, 3, b);
+    if(Insert_(L, grid, id, b) != 0)
+        return luaL_argerror(L, 2, "duplicated id");
+    return 0;
+    }
+
+static int Move(lua_State *L)
+    {
+    box_t b;
+    grid_t *grid = checkgrid(L, 1, NULL);
+    lua_Integer id = luaL_checkinteger(L, 2);
+    CheckObject(L, 3, b);
+    Move_(L, grid, id, b);
+    return 0;
+    }
+
+static int Remove(lua_State *L)
+    {
+    grid_t *grid = checkgrid(L, 1, NULL);
+    lua_Integer id = luaL_checkinteger(L, 2);
+    lua_pushboolean(L, Remove_(grid, id));
+    return 1;
+    }
+
+static int Contains(lua_State *L)
+    {
+    grid_t *grid = checkgrid(L, 1, NULL);
+    lua_Integer id = luaL_checkinteger(L, 2);
+    lua_pushboolean(L, hashmap_get(&grid->idmap, (uint64_t)id) != NONE);
+    return 1;
+    }
+
+static int Batch(lua_State *L, int boxes, int move)
+/* insert_points/move_points/insert_boxes/move_boxes(hostmem, [count], [type], [firstid]) */
+    {
+    size_t i, count;
+    box_t b;
+    char *p;
+    grid_t *grid = checkgrid(L, 1, NULL);
+    int type = checkrealtype(L, 4);
+    lua_Integer firstid = luaL_optinteger(L, 5, 1);
+    size_t n = boxes ? 6 : 3;
+    p = checkhostmemarray(L, 2, 3, n * sizeoftype(type), &count);
+    for(i = 0; i < count; i++, p += n * sizeoftype(type))
+        {
+        if(boxes)
+            {
+            b[0] = getreal(p, type, 0); b[1] = getreal(p, type, 1);
+            b[2] = getreal(p, type, 2); b[3] = getreal(p, type, 3);
+            b[4] = getreal(p, type, 4); b[5] = getreal(p, type, 5);
+            }
+        else
+            {
+            b[0] = b[1] = getreal(p, type, 0);
+            b[2] = b[3] = getreal(p, type, 1);
+            b[4] = b[5] = getreal(p, type, 2);
+            }
+        if(move)
+            Move_(L, grid, firstid + i, b);
+        else if(Insert_(L, grid, firstid + i, b) != 0)
+            return luaL_error(L, "duplicated id %I", (lua_Integer)(firstid + i));
+        }
+    return 0;
+    }
+
+static int InsertPoints(lua_State *L) { return Batch(L, 0, 0); }
+static int MovePoints(lua_State *L) { return Batch(L, 0, 1); }
+static int InsertBoxes(lua_State *L) { return Batch(L, 1, 0); }
+static int MoveBoxes(lua_State *L) { return Batch(L, 1, 1); }
+
+static int QueryRadius(lua_State *L)
+    {
+    vec_t c;
+    box_t qb;
+    grid_t *grid = checkgrid(L, 1, NULL);
+    double r;
+    checkvec(L, 2, c, NULL, NULL);
+    r = luaL_checknumber(L, 3);
+    if(r < 0)
+        return luaL_argerror(L, 3, errstring(ERR_VALUE));
+    qb[0] = c[0] - r; qb[1] = c[0] + r;
+    qb[2] = c[1] - r; qb[3] = c[1] + r;
+    qb[4] = c[2] - r; qb[5] = c[2] + r;
+    return Query(L, grid, qb, c, r*r);
+    }
+
+static int QueryBox(lua_State *L)
+    {
+    box_t qb;
+    grid_t *grid = checkgrid(L, 1, NULL);
+    checkbox(L, 2, qb, NULL);
+    return Query(L, grid, qb, NULL, 0);
+    }
+
+static int Count(lua_State *L)
+    {
+    grid_t *grid = checkgrid(L, 1, NULL);
+    lua_pushinteger(L, grid->count);
+    return 1;
+    }
+
+static int CellSize(lua_State *L)
+    {
+    grid_t *grid = checkgrid(L, 1, NULL);
+    lua_pushnumber(L, grid->cellsize);
+    return 1;
+    }
+
+static int Clear(lua_State *L)
+    {
+    grid_t *grid = checkgrid(L, 1, NULL);
+    Clear_(grid);
+    return 0;
+    }
+
+RAW_FUNC(grid)
+TYPE_FUNC(grid)
+DELETE_FUNC(grid)
+
+static const struct luaL_Reg Methods[] = 
+    {
+        { "raw", Raw },
+        { "type", Type },
+        { "free", Delete },
+        { "insert", Insert },
+        { "move", Move },
+        { "remove", Remove },
+        { "contains", Contains },
+        { "insert_points", InsertPoints },
+        { "move_points", MovePoints },
+        { "insert_boxes", InsertBoxes },
+        { "move_boxes", MoveBoxes },
+        { "query_radius", QueryRadius },
+        { "query_box", QueryBox },
+        { "count", Count },
+        { "cellsize", CellSize },
+        { "clear", Clear },
+        { NULL, NULL } /* sentinel */
+    };
+
+static const struct luaL_Reg MetaMethods[] = 
+    {
+        { "__gc",  Delete },
+        { NULL, NULL } /* sentinel */
+    };
+
+static const struct luaL_Reg Functions[] = 
+    {
+        { "grid", Create },
+        { NULL, NULL } /* sentinel */
+    };
+
+void moonglmath_open_grid(lua_State *L)
+    {
+    udata_define(L, GRID_MT, Methods, MetaMethods);
+    luaL_setfuncs(L, Functions, 0);
+    }
+
@@ -0,0 +1,348 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Stefano Trettel
+ *
+ * Software repository: MoonGLMATH, https://github.com/stetre/moonglmath
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "internal.h"
+
+/* Transform hierarchy.
+ *
+ * Nodes are identified by their index (1-based) and stored in flat arrays in topological
+ * order, i.e. each node comes after its parent (this is guaranteed by construction, since a
+ * node can only be added as a child of an existing node).
+ * Each node has a local transform, given as translation, rotation and scale (TRS), and a
+ * world transform computed as world(parent) * local. Changing the local transform of a node
+ * marks it as dirty, and update() recomputes the world matrices of the dirty nodes and of
+ * their descendants only, in a single forward pass starting from the first dirty node.
+ */
+
+#define DIRTY   1 /* local transform changed */
+#define UPDATED 2 /* world matrix recomputed in the current update */
+
+#define NTRS 10 /* t[3], q[4], s[3] */
+
+struct moonglmath_hierarchy_s {
+    uint32_t count, cap;
+    uint32_t *parent; /* parent index (1-based), or 0 for root nodes */
+    double *trs; /* local transforms, NTRS values per node */
+    mat_t *world; /* world matrices */
+    unsigned char *flags;
+    uint32_t firstdirty; /* index (0-based) of the first dirty node, or count */
+};
+
+static const double IdentityTRS[NTRS] = { 0, 0, 0,  1, 0, 0, 0,  1, 1, 1 };
+
+static void Grow(lua_State *L, hierarchy_t *h)
+    {
+    uint32_t cap = 2 * h->cap;
+    h->parent = (uint32_t*)Realloc(L, h->parent, h->cap * sizeof(uint32_t), cap * sizeof(uint32_t));
+    h->trs = (double*)Realloc(L, h->trs, h->cap * NTRS * sizeof(double), cap * NTRS * sizeof(double));
+    h->world = (mat_t*)Realloc(L, h->world, h->cap * sizeof(mat_t), cap * sizeof(mat_t));
+    h->flags = (unsigned char*)Realloc(L, h->flags, h->cap, cap);
+    h->cap = cap;
+    }
+
+static uint32_t Add_(lua_State *L, hierarchy_t *h, uint32_t parent)
+/* Adds a node with identity local transform, and returns its index (1-based) */
+    {
+    uint32_t i;
+    if(h->count == h->cap) Grow(L, h);
+    i = h->count++;
+    h->parent[i] = parent;
+    memcpy(&h->trs[i*NTRS], IdentityTRS, sizeof(IdentityTRS));
+    h->flags[i] = DIRTY;
+    if(i < h->firstdirty) h->firstdirty = i;
+    return i + 1;
+    }
+
+static void MarkDirty(hierarchy_t *h, uint32_t i)
+    {
+    h->flags[i] |= DIRTY;
+    if(i < h->firstdirty) h->firstdirty = i;
+    }
+
+static void WriteMat(char *p, int type, uint32_t i, mat_t m)
+/* Writes m in row-major order as the i-th element of a packed array of 4x4 matrices */
+    {
+    int r, c;
+    for(r = 0; r < 4; r++)
+        for(c = 0; c < 4; c++)
+            setreal(p, type, 16*i + 4*r + c, m[r][c]);
+    }
+
+static uint32_t Update_(hierarchy_t *h, char *p, int type)
+/* Recomputes the world matrices of the dirty nodes and of their descendants, and writes
+ * them to the packed array p (if not NULL). Returns the number of updated nodes.
+ */
+    {
+    uint32_t i, parent, n = 0;
+    double *trs;
+    mat_t local;
+    for(i = h->firstdirty; i < h->count; i++)
+        {
+        parent = h->parent[i];
+        if(!(h->flags[i] & DIRTY) && !(parent && (h->flags[parent-1] & UPDATED)))
+            continue;
+        trs = &h->trs[i*NTRS];
+        if(parent)
+            {
+            compose_trs(local, trs, trs + 3, trs + 7);
+            mat_affine_mul(h->world[i], h->world[parent-1], local);
+            }
+        else
+            compose_trs(h->world[i], trs, trs + 3, trs + 7);
+        h->flags[i] = UPDATED;
+        if(p) WriteMat(p, type, i, h->world[i]);
+        n++;
+        }
+    for(i = h->firstdirty; i < h->count; i++)
+        h->flags[i] = 0;
+    h->firstdirty = h->count;
+    return n;
+    }
+
+/*------------------------------------------------------------------------------*
+ | Lua functions                                                                |
+ *------------------------------------------------------------------------------*/
+
+static int freehierarchy(lua_State *L, ud_t *ud)
+    {
+    hierarchy_t *h = (hierarchy_t*)ud->handle;
+    if(!freeuserdata(L, ud, "hierarchy")) return 0;
+    Free(L, h->parent);
+    Free(L, h->trs);
+    Free(L, h->world);
+    Free(L, h->flags);
+    Free(L, h);
+    return 0;
+    }
+
+static uint32_t CheckNode(lua_State *L, int arg, hierarchy_t *h)
+/* Returns the 0-based index of the node */
+    {
+    lua_Integer i = luaL_checkinteger(L, arg);
+    if(i < 1 || i > (lua_Integer)h->count)
+        return (uint32_t)luaL_argerror(L, arg, "invalid node index");
+    return (uint32_t)(i - 1);
+    }
+
+static uint32_t CheckParent(lua_State *L, int arg, uint32_t count)
+    {
+    lua_Integer parent = luaL_optinteger(L, arg, 0);
+    if(parent < 0 || parent > (lua_Integer)count)
+        return (uint32_t)luaL_argerror(L, arg, "invalid parent index");
+    return (uint32_t)parent;
+    }
+
+static int Create(lua_State *L)
+/* hierarchy([{parent}]) */
+    {
+    ud_t *ud;
+    hierarchy_t *h;
+    lua_Integer i, n = 0;
+    uint32_t parent;
+    if(!lua_isnoneornil(L, 1))
+        {
+        luaL_checktype(L, 1, LUA_TTABLE);
+        n = luaL_len(L, 1);
+        }
+    h = (hierarchy_t*)Malloc(L, sizeof(hierarchy_t));
+    ud = newuserdata(L, h, HIERARCHY_MT, "hierarchy");
+    ud->destructor = freehierarchy;
+    h->cap = 16;
+    h->parent = (uint32_t*)Malloc(L, h->cap * sizeof(uint32_t));
+    h->trs = (double*)Malloc(L, h->cap * NTRS * sizeof(double));
+    h->world = (mat_t*)Malloc(L, h->cap * sizeof(mat_t));
+    h->flags = (unsigned char*)Malloc(L, h->cap);
+    for(i = 1; i <= n; i++)
+        {
+        lua_rawgeti(L, 1, i);
+        parent = CheckParent(L, -1, h->count);
+        lua_pop(L, 1);
+        Add_(L, h, parent);
+        }
+    return 1;
+    }
+
+static int Add(lua_State *L)
+    {
+    hierarchy_t *h = checkhierarchy(L, 1, NULL);
+    uint32_t parent = CheckParent(L, 2, h->count);
+    lua_pushinteger(L, Add_(L, h, parent));
+    return 1;
+    }
+
+static int Parent(lua_State *L)
+    {
+    hierarchy_t *h = checkhierarchy(L, 1, NULL);
+    uint32_t i = CheckNode(L, 2, h);
+    lua_pushinteger(L, h->parent[i]);
+    return 1;
+    }
+
+static int Count(lua_State *L)
+    {
+    hierarchy_t *h = checkhierarchy(L, 1, NULL);
+    lua_pushinteger(L, h->count);
+    return 1;
+    }
+
+static int Set(lua_State *L)
+/* set(i, [t], [q], [s]) */
+    {
+    vec_t v;
+    quat_t q;
+    hierarchy_t *h = checkhierarchy(L, 1, NULL);
+    uint32_t i = CheckNode(L, 2, h);
+    double *trs = &h->trs[i*NTRS];
+    if(!lua_isnoneornil(L, 3))
+        {
+        checkvec(L, 3, v, NULL, NULL);
+        memcpy(trs, v, 3*sizeof(double));
+        }
+    if(!lua_isnoneornil(L, 4))
+        {
+        checkquat(L, 4, q);
+        memcpy(trs + 3, q, 4*sizeof(double));
+        }
+    if(!lua_isnoneornil(L, 5))
+        {
+        if(lua_isnumber(L, 5)) 
+            v[0] = v[1] = v[2] = lua_tonumber(L, 5);
+        else
+            checkvec(L, 5, v, NULL, NULL);
+        memcpy(trs + 7, v, 3*sizeof(double));
+        }
+    MarkDirty(h, i);
+    return 0;
+    }
+
+static int Get(lua_State *L)
+    {
+    hierarchy_t *h = checkhierarchy(L, 1, NULL);
+    uint32_t i = CheckNode(L, 2, h);
+    double *trs = &h->trs[i*NTRS];
+    pushvec(L, trs, 3, 3, 0);
+    pushquat(L, trs + 3);
+    pushvec(L, trs + 7, 3, 3, 0);
+    return 3;
+    }
+
+static int SetTRS(lua_State *L)
+/* set_trs(hostmem, [count], [type], [first=1]) */
+    {
+    size_t count, i, k;
+    hierarchy_t *h = checkhierarchy(L, 1, NULL);
+    int type = checkrealtype(L, 4);
+    lua_Integer first = luaL_optinteger(L, 5, 1);
+    char *p = checkhostmemarray(L, 2, 3, NTRS * sizeoftype(type), &count);
+    if(count == 0) return 0;
+    if(first < 1 || (first - 1 + count) > h->count)
+        return luaL_error(L, errstring(ERR_BOUNDARIES));
+    for(i = 0; i < count; i++)
+        {
+        for(k = 0; k < NTRS; k++)
+            h->trs[(first - 1 + i)*NTRS + k] = getreal(p, type, i*NTRS + k);
+        h->flags[first - 1 + i] |= DIRTY;
+        }
+    if((uint32_t)(first - 1) < h->firstdirty) h->firstdirty = (uint32_t)(first - 1);
+    return 0;
+    }
+
+static int Update(lua_State *L)
+/* n = update([hostmem], [type]) */
+    {
+    size_t count;
+    char *p = NULL;
+    hierarchy_t *h = checkhierarchy(L, 1, NULL);
+    int type = checkrealtype(L, 3);
+    if(!lua_isnoneornil(L, 2))
+        {
+        count = h->count;
+        p = checkhostmemarray(L, 2, 0, 16 * sizeoftype(type), &count);
+        }
+    lua_pushinteger(L, Update_(h, p, type));
+    return 1;
+    }
+
+static int Write(lua_State *L)
+/* write(hostmem, [type]) */
+    {
+    uint32_t i;
+    size_t count;
+    hierarchy_t *h = checkhierarchy(L, 1, NULL);
+    int type = checkrealtype(L, 3);
+    char *p;
+    count = h->count;
+    p = checkhostmemarray(L, 2, 0, 16 * sizeoftype(type), &count);
+    for(i = 0; i < h->count; i++)
+        WriteMat(p, type, i, h->world[i]);
+    return 0;
+    }
+
+static int World(lua_State *L)
+    {
+    hierarchy_t *h = checkhierarchy(L, 1, NULL);
+    uint32_t i = CheckNode(L, 2, h);
+    return pushmat(L, h->world[i], 4, 4, 4, 4);
+    }
+
+RAW_FUNC(hierarchy)
+TYPE_FUNC(hierarchy)
+DELETE_FUNC(hierarchy)
+
+static const struct luaL_Reg Methods[] = 
+    {
+        { "raw", Raw },
+        { "type", Type },
+        { "free", Delete },
+        { "add", Add },
+        { "parent", Parent },
+        { "count", Count },
+        { "set", Set },
+        { "get", Get },
+        { "set_trs", SetTRS },
+        { "update", Update },
+        { "write", Write },
+        { "world", World },
+        { NULL, NULL } /* sentinel */
+    };
+
+static const struct luaL_Reg MetaMethods[] = 
+    {
+        { "__gc",  Delete },
+        { NULL, NULL } /* sentinel */
+    };
+
+static const struct luaL_Reg Functions[] = 
+    {
+        { "hierarchy", Create },
+        { NULL, NULL } /* sentinel */
+    };
+
+void moonglmath_open_hierarchy(lua_State *L)
+    {
+    udata_define(L, HIERARCHY_MT, Methods, MetaMethods);
+    luaL_setfuncs(L, Functions, 0);
+    }
+
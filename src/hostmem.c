@@ -80,8 +80,9 @@ static int CreatePack(lua_State *L, int arg, size_t alignment)
     int err;
     char *ptr;
     int type = checktype(L, arg);
+    int swap = lua_istable(L, arg+1) ? checkbyteswap(L, arg+2) : 0;
     size_t n = toflattable(L, arg+1);
-    size_t size = n * sizeoftype(type);
+    size_t size = sizeofvalues(type, n);
     (void)alignment;
 
     if(size == 0) 
@@ -100,6 +101,8 @@ static int CreatePack(lua_State *L, int arg, size_t alignment)
         free(ptr);
         return luaL_argerror(L, arg+1, errstring(err));
         }
+    if(swap)
+        byteswap(ptr, sizeoftype(type), size / sizeoftype(type));
 
     CreateAllocated(L, ptr, size);
     return 1;
@@ -244,10 +247,11 @@ static int WritePack(lua_State *L)
     hostmem_t* hostmem = checkhostmem(L, 1, NULL);
     size_t offset = luaL_checkinteger(L, 2);
     int type = checktype(L, 3);
+    int swap = lua_istable(L, 4) ? checkbyteswap(L, 5) : 0;
     size_t size = hostmem->size - offset;
     if(offset >= hostmem->size)
         return luaL_error(L, errstring(ERR_BOUNDARIES));
-    checkdata(L, 4, type, hostmem->ptr + offset, size);
+    checkdata(L, 4, type, hostmem->ptr + offset, size, swap);
     return 0;
     }
 
@@ -309,7 +313,7 @@ static int Read(lua_State *L)
         type = checktype(L, 4);
         if(size == 0)
             { lua_newtable(L); return 1; }
-        return pushdata(L, type, hostmem->ptr + offset, size);
+        return pushdata(L, type, hostmem->ptr + offset, size, checkbyteswap(L, 5));
         }
     if(size == 0)
         lua_pushstring(L, ""); 
@@ -318,6 +322,23 @@ static int Read(lua_State *L)
     return 1;
     }
 
+static int ByteSwap(lua_State *L)
+/* byteswap(type, [offset], [size])
+ * Reverses in place the byte order of the elements of the given type.
+ */
+    {
+    hostmem_t* hostmem = checkhostmem(L, 1, NULL);
+    size_t elemsize = sizeoftype(checktype(L, 2));
+    size_t offset = luaL_optinteger(L, 3, 0);
+    size_t size = luaL_optinteger(L, 4, hostmem->size - offset);
+    if((offset >= hostmem->size) || (size > hostmem->size - offset))
+        return luaL_error(L, errstring(ERR_BOUNDARIES));
+    if((size % elemsize) != 0)
+        return luaL_argerror(L, 4, errstring(ERR_LENGTH));
+    byteswap(hostmem->ptr + offset, elemsize, size / elemsize);
+    return 0;
+    }
+
 static int Ptr(lua_State *L)
     {
     hostmem_t* hostmem = checkhostmem(L, 1, NULL);
@@ -357,6 +378,55 @@ static int Size(lua_State *L)
     }
 
 
+/*------------------------------------------------------------------------------*
+ | Packed arrays                                                                |
+ *------------------------------------------------------------------------------*/
+
+char *checkhostmemarray(lua_State *L, int arg, int countarg, size_t elemsize, size_t *count)
+/* Checks that the element at arg is a hostmem containing a packed array of elements
+ * of elemsize bytes each, starting from the beginning of its memory area, and returns
+ * a pointer to the first element.
+ * If countarg is not 0, the number of elements is taken from the optional integer
+ * at countarg (defaulting to as many elements as fit in the memory area) and returned
+ * in *count. Otherwise *count is expected to contain the number of elements.
+ * In both cases, raises an error if the elements exceed the memory boundaries.
+ */
+    {
+    lua_Integer n;
+    hostmem_t* hostmem = checkhostmem(L, arg, NULL);
+    if(countarg != 0)
+        {
+        n = luaL_optinteger(L, countarg, hostmem->size / elemsize);
+        if(n < 0)
+            { luaL_argerror(L, countarg, errstring(ERR_VALUE)); return NULL; }
+        *count = (size_t)n;
+        }
+    if(*count > hostmem->size / elemsize)
+        { luaL_error(L, errstring(ERR_BOUNDARIES)); return NULL; }
+    return hostmem->ptr;
+    }
+
+void *moonglmath_testhostmemptr(lua_State *L, int arg, size_t *size)
+/* If the element at arg is a hostmem, returns a pointer to its memory area and sets
+ * *size to its size in bytes. Otherwise returns NULL.
+ * (These two functions are part of the C API, see moonglmath.h).
+ */
+    {
+    hostmem_t* hostmem = testhostmem(L, arg, NULL);
+    if(!hostmem) return NULL;
+    if(size) *size = hostmem->size;
+    return hostmem->ptr;
+    }
+
+void *moonglmath_checkhostmemptr(lua_State *L, int arg, size_t *size)
+/* Same as moonglmath_testhostmemptr(), but raises an error if arg is not a hostmem */
+    {
+    hostmem_t* hostmem = checkhostmem(L, arg, NULL);
+    if(size) *size = hostmem->size;
+    return hostmem->ptr;
+    }
+
+
 RAW_FUNC(hostmem)
 TYPE_FUNC(hostmem)
 DELETE_FUNC(hostmem)
@@ -369,6 +439,7 @@ static const struct luaL_Reg Methods[] =
         { "write", Write },
         { "copy", Copy },
         { "clear", Clear },
+        { "byteswap", ByteSwap },
         { "read", Read },
         { "ptr", Ptr },
         { "size", Size },
@@ -36,6 +36,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <math.h>
+#include <float.h>
 #include <time.h>
 #include <sys/time.h>
 #include "moonglmath_local.h"
@@ -97,6 +98,8 @@
 void *Malloc(lua_State *L, size_t size);
 #define MallocNoErr moonglmath_MallocNoErr
 void *MallocNoErr(lua_State *L, size_t size);
+#define Realloc moonglmath_Realloc
+void *Realloc(lua_State *L, void *ptr, size_t oldsize, size_t newsize);
 #define Strdup moonglmath_Strdup
 char *Strdup(lua_State *L, const char *s);
 #define Free moonglmath_Free
@@ -120,6 +123,12 @@ int notavailable(lua_State *L, ...);
 int newmetatable(lua_State *L, const char *metatable);
 #define setmetatable moonglmath_setmetatable
 int setmetatable(lua_State *L, const char *metatable);
+#define settypetag moonglmath_settypetag
+int settypetag(lua_State *L, const char *metatable, int tag);
+#define typetag moonglmath_typetag
+int typetag(lua_State *L, int arg);
+#define newshapemetatable moonglmath_newshapemetatable
+int newshapemetatable(lua_State *L, const char *family, const char *name, const void *key);
 #define metatable_setfuncs moonglmath_metatable_setfuncs
 int metatable_setfuncs(lua_State *L, const char *metatable, const luaL_Reg *metamethods, 
             const luaL_Reg *methods);
@@ -131,6 +140,16 @@ void *checklightuserdataorzero(lua_State *L, int arg);
 void *optlightuserdata(lua_State *L, int arg);
 
 
+/* Type tags (see typetag()) */
+#define TAG_NONE        0
+#define TAG_VEC         1
+#define TAG_MAT         2
+#define TAG_QUAT        3
+#define TAG_COMPLEX     4
+#define TAG_DUALQUAT    5
+#define TAG_BOX         6
+#define TAG_RECT        7
+
 #define checkvecsize(L, sz) do {                        \
     if(((sz)<1) || ((sz)>4))                            \
         return luaL_error(L, "invalid vector size");    \
@@ -154,6 +173,8 @@ int vec_Norm(lua_State *L);
 int vec_Norm2(lua_State *L);
 #define vec_Normalize moonglmath_vec_Normalize
 int vec_Normalize(lua_State *L);
+#define vec_FastNormalize moonglmath_vec_FastNormalize
+int vec_FastNormalize(lua_State *L);
 #define vec_Transpose moonglmath_vec_Transpose
 int vec_Transpose(lua_State *L);
 #define vec_Clamp moonglmath_vec_Clamp
@@ -188,6 +209,14 @@ int mat_Det(lua_State *L);
 int mat_Inv(lua_State *L);
 #define mat_Adj moonglmath_mat_Adj
 int mat_Adj(lua_State *L);
+#define mat_AffineInv moonglmath_mat_AffineInv
+int mat_AffineInv(lua_State *L);
+#define mat_RigidInv moonglmath_mat_RigidInv
+int mat_RigidInv(lua_State *L);
+#define mat_AffineMul moonglmath_mat_AffineMul
+int mat_AffineMul(lua_State *L);
+#define mat_IsAffine moonglmath_mat_IsAffine
+int mat_IsAffine(lua_State *L);
 #define mat_Column moonglmath_mat_Column
 int mat_Column(lua_State *L);
 #define mat_Row moonglmath_mat_Row
@@ -222,6 +251,12 @@ int quat_FromMat(lua_State *L);
 int quat_Mix(lua_State *L);
 #define quat_Slerp moonglmath_quat_Slerp
 int quat_Slerp(lua_State *L);
+#define quat_FastNormalize moonglmath_quat_FastNormalize
+int quat_FastNormalize(lua_State *L);
+#define quat_Nlerp moonglmath_quat_Nlerp
+int quat_Nlerp(lua_State *L);
+#define quat_FastSlerp moonglmath_quat_FastSlerp
+int quat_FastSlerp(lua_State *L);
 
 /* complex.c ------------------------------------------------------------------------*/
 #define complex_Norm moonglmath_complex_Norm
@@ -237,6 +272,17 @@ int complex_Parts(lua_State *L);
 #define complex_Conj moonglmath_complex_Conj
 int complex_Conj(lua_State *L);
 
+/* dualquat.c --------------------------------------------------------------------*/
+
+#define dualquat_Parts moonglmath_dualquat_Parts
+int dualquat_Parts(lua_State *L);
+#define dualquat_Conj moonglmath_dualquat_Conj
+int dualquat_Conj(lua_State *L);
+#define dualquat_Normalize moonglmath_dualquat_Normalize
+int dualquat_Normalize(lua_State *L);
+#define dualquat_Sclerp moonglmath_dualquat_Sclerp
+int dualquat_Sclerp(lua_State *L);
+
 /* num.c -------------------------------------------------------------------------*/
 
 #define num_Clamp moonglmath_num_Clamp
@@ -249,19 +295,54 @@ int num_Step(lua_State *L);
 int num_Smoothstep(lua_State *L);
 #define num_Fade moonglmath_num_Fade
 int num_Fade(lua_State *L);
+#define num_FastRsqrt moonglmath_num_FastRsqrt
+int num_FastRsqrt(lua_State *L);
 
 /* datahandling.c */
 #define sizeoftype moonglmath_sizeoftype
 size_t sizeoftype(int type);
+#define sizeofvalues moonglmath_sizeofvalues
+size_t sizeofvalues(int type, size_t n);
+#define encodevalues moonglmath_encodevalues
+void encodevalues(int type, const double *src, size_t n, void *dst);
+#define decodevalues moonglmath_decodevalues
+void decodevalues(int type, const void *src, size_t n, double *dst);
+#define float_to_half moonglmath_float_to_half
+uint16_t float_to_half(float x);
+#define half_to_float moonglmath_half_to_float
+float half_to_float(uint16_t h);
 #define toflattable moonglmath_toflattable
 int toflattable(lua_State *L, int arg);
 #define testdata moonglmath_testdata
 int testdata(lua_State *L, int type, size_t n, void *dst, size_t dstsize);
 #define checkdata moonglmath_checkdata
-int checkdata(lua_State *L, int arg, int type, void *dts, size_t dstsize);
+int checkdata(lua_State *L, int arg, int type, void *dts, size_t dstsize, int swap);
 #define pushdata moonglmath_pushdata
-int pushdata(lua_State *L, int type, void *src, size_t srcsize);
+int pushdata(lua_State *L, int type, void *src, size_t srcsize, int swap);
+#define checkbyteswap moonglmath_checkbyteswap
+int checkbyteswap(lua_State *L, int arg);
+#define byteswap moonglmath_byteswap
+void byteswap(void *data, size_t elemsize, size_t count);
+#define checkrealtype moonglmath_checkrealtype
+int checkrealtype(lua_State *L, int arg);
+
+/* Access to the i-th element of a packed array of 'float' or 'double' 
+ * (type = MOONGLMATH_TYPE_FLOAT or MOONGLMATH_TYPE_DOUBLE, see checkrealtype()) */
+#define getreal(p, type, i) ((type) == MOONGLMATH_TYPE_FLOAT ? \
+            (double)((float*)(p))[(i)] : ((double*)(p))[(i)])
+#define setreal(p, type, i, val) do {                                   \
+    if((type) == MOONGLMATH_TYPE_FLOAT) ((float*)(p))[(i)] = (float)(val);  \
+    else ((double*)(p))[(i)] = (val);                                   \
+} while(0)
+
 
+/* pool.c */
+#define POOL_VEC    1
+#define POOL_MAT    2
+#define POOL_QUAT   3
+#define POOL_NKINDS 3
+#define pooltake moonglmath_pooltake
+int pooltake(lua_State *L, int kind);
 
 /* main.c */
 int luaopen_moonglmath(lua_State *L);
@@ -275,9 +356,14 @@ void moonglmath_open_box(lua_State *L);
 void moonglmath_open_rect(lua_State *L);
 void moonglmath_open_quat(lua_State *L);
 void moonglmath_open_complex(lua_State *L);
+void moonglmath_open_dualquat(lua_State *L);
+void moonglmath_open_fft(lua_State *L);
 void moonglmath_open_transform(lua_State *L);
 void moonglmath_open_viewing(lua_State *L);
 void moonglmath_open_funcs(lua_State *L);
+void moonglmath_open_raycast(lua_State *L);
+void moonglmath_open_pool(lua_State *L);
+void moonglmath_open_api(lua_State *L);
 
 /*------------------------------------------------------------------------------*
  | Debug and other utilities                                                    |
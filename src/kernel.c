@@ -0,0 +1,654 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Stefano Trettel
+ *
+ * Software repository: MoonGLMATH, https://github.com/stetre/moonglmath
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "internal.h"
+
+/* Compiled kernels.
+ *
+ * A kernel is a short sequence of operations on named variables, compiled once and then 
+ * applied to all the elements of packed arrays (see doc/hostmem.adoc, "Packed arrays").
+ * Variables are either per-element (inputs, outputs and temporaries, with 1 to 4 components)
+ * or uniform (numbers, vectors and matrices, bound once per run, and numeric literals).
+ *
+ * Elements are processed in blocks of BLOCK elements: each instruction is executed on a
+ * whole block before moving to the next one, so that the cost of decoding it is amortized
+ * over the block.
+ */
+
+#define BLOCK 64
+
+/* variable kinds */
+#define V_IN        1   /* per-element, read from an array */
+#define V_OUT       2   /* per-element, written to an array */
+#define V_TEMP      3   /* per-element */
+#define V_UNIFORM   4   /* number or vector */
+#define V_MATRIX    5
+#define V_CONST     6   /* numeric literal */
+
+typedef struct {
+    char *name;     /* NULL for literals */
+    int kind;
+    int width;      /* no. of components (for matrices, no. of rows) */
+    int columns;    /* matrices only */
+    int defined;    /* temporaries and outputs: assigned by a previous instruction */
+    double value;   /* literals only */
+    double *data;   /* BLOCK*4 values (per-element), 4 values (uniform), or 16 (matrix) */
+} var_t;
+
+/* opcodes */
+enum {
+    OP_MOV = 1, OP_NEG, OP_ABS, OP_SQRT, OP_FLOOR, OP_LENGTH, OP_NORMALIZE,
+    OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_MIN, OP_MAX, OP_DOT, OP_CROSS,
+    OP_MAD, OP_CLAMP, OP_MIX, OP_MXV, OP_TRANSFORM, OP_PROJECT, OP_VEC, OP_SWIZZLE,
+};
+
+static const struct { const char *name; int op; int nsrc; } Ops[] = {
+    { "mov", OP_MOV, 1 },
+    { "neg", OP_NEG, 1 },
+    { "abs", OP_ABS, 1 },
+    { "sqrt", OP_SQRT, 1 },
+    { "floor", OP_FLOOR, 1 },
+    { "length", OP_LENGTH, 1 },
+    { "normalize", OP_NORMALIZE, 1 },
+    { "add", OP_ADD, 2 },
+    { "sub", OP_SUB, 2 },
+    { "mul", OP_MUL, 2 },
+    { "div", OP_DIV, 2 },
+    { "min", OP_MIN, 2 },
+    { "max", OP_MAX, 2 },
+    { "dot", OP_DOT, 2 },
+    { "cross", OP_CROSS, 2 },
+    { "mad", OP_MAD, 3 },
+    { "clamp", OP_CLAMP, 3 },
+    { "mix", OP_MIX, 3 },
+    { "mxv", OP_MXV, 2 },
+    { "transform", OP_TRANSFORM, 2 },
+    { "project", OP_PROJECT, 2 },
+    { "vec", OP_VEC, -1 }, /* 1 to 4 sources */
+    { "swizzle", OP_SWIZZLE, 1 }, /* + pattern */
+    { NULL, 0, 0 },
+};
+
+typedef struct {
+    int op;
+    int dst;
+    int nsrc;
+    int src[4];
+    int swizzle[4]; /* OP_SWIZZLE only */
+} instr_t;
+
+struct moonglmath_kernel_s {
+    int nvars;
+    var_t *vars;
+    int ninstr;
+    instr_t *instr;
+    double *data; /* storage for all variables */
+    char **ptr; /* arrays bound to inputs and outputs (scratch for run) */
+};
+
+/*------------------------------------------------------------------------------*
+ | Compilation                                                                  |
+ *------------------------------------------------------------------------------*/
+
+static int FindVar(kernel_t *k, const char *name)
+    {
+    int i;
+    for(i = 0; i < k->nvars; i++)
+        if(k->vars[i].name && strcmp(k->vars[i].name, name) == 0) return i;
+    return -1;
+    }
+
+static int ParseDecl(lua_State *L, const char *name, const char *spec, var_t *var)
+    {
+    int n, m;
+    char c;
+    var->columns = 0;
+    if(sscanf(spec, "in%d%c", &n, &c) == 1 && n >= 1 && n <= 4)
+        { var->kind = V_IN; var->width = n; }
+    else if(sscanf(spec, "out%d%c", &n, &c) == 1 && n >= 1 && n <= 4)
+        { var->kind = V_OUT; var->width = n; }
+    else if(strcmp(spec, "number") == 0)
+        { var->kind = V_UNIFORM; var->width = 1; }
+    else if(sscanf(spec, "vec%d%c", &n, &c) == 1 && n >= 2 && n <= 4)
+        { var->kind = V_UNIFORM; var->width = n; }
+    else if(sscanf(spec, "mat%dx%d%c", &n, &m, &c) == 2 && n >= 2 && n <= 4 && m >= 2 && m <= 4)
+        { var->kind = V_MATRIX; var->width = n; var->columns = m; }
+    else if(sscanf(spec, "mat%d%c", &n, &c) == 1 && n >= 2 && n <= 4)
+        { var->kind = V_MATRIX; var->width = n; var->columns = n; }
+    else
+        return luaL_error(L, "invalid declaration '%s' for '%s'", spec, name);
+    return 0;
+    }
+
+static int Operand(lua_State *L, kernel_t *k, int pc, int idx)
+/* Resolves the operand at index idx of the instruction table on top of the stack */
+    {
+    int i;
+    var_t *var;
+    lua_rawgeti(L, -1, idx);
+    if(lua_type(L, -1) == LUA_TNUMBER)
+        {
+        i = k->nvars++;
+        var = &k->vars[i];
+        var->kind = V_CONST;
+        var->width = 1;
+        var->defined = 1;
+        var->value = lua_tonumber(L, -1);
+        }
+    else if(lua_type(L, -1) == LUA_TSTRING)
+        {
+        i = FindVar(k, lua_tostring(L, -1));
+        if(i < 0 || !k->vars[i].defined)
+            return luaL_error(L, "instruction %d: undefined variable '%s'", pc, lua_tostring(L, -1));
+        }
+    else
+        return luaL_error(L, "instruction %d: invalid operand #%d", pc, idx - 2);
+    lua_pop(L, 1);
+    return i;
+    }
+
+static int Compile(lua_State *L, kernel_t *k, int pc)
+/* Compiles the instruction table on top of the stack: { dst, opname, src1, ... } */
+    {
+    instr_t *in = &k->instr[pc-1];
+    int i, j, w, set = 0, cur, nsrc = 0, op = 0, dst;
+    const char *name, *opname, *pattern;
+    var_t *v[4], *d;
+    if(lua_type(L, -1) != LUA_TTABLE)
+        return luaL_error(L, "instruction %d: table expected", pc);
+    lua_rawgeti(L, -1, 2);
+    opname = lua_tostring(L, -1);
+    for(i = 0; opname && Ops[i].name; i++)
+        if(strcmp(Ops[i].name, opname) == 0) { op = Ops[i].op; nsrc = Ops[i].nsrc; break; }
+    lua_pop(L, 1);
+    if(op == 0)
+        return luaL_error(L, "instruction %d: invalid operation", pc);
+    if(nsrc < 0) /* variable no. of sources */
+        {
+        nsrc = (int)luaL_len(L, -1) - 2;
+        if(nsrc < 1 || nsrc > 4)
+            return luaL_error(L, "instruction %d: invalid number of operands", pc);
+        }
+    else if((int)luaL_len(L, -1) != nsrc + 2 + (op == OP_SWIZZLE ? 1 : 0))
+        return luaL_error(L, "instruction %d: invalid number of operands", pc);
+    in->op = op;
+    in->nsrc = nsrc;
+    for(i = 0; i < nsrc; i++)
+        {
+        in->src[i] = Operand(L, k, pc, i + 3);
+        v[i] = &k->vars[in->src[i]];
+        if(v[i]->kind == V_MATRIX && !((op == OP_MXV || op == OP_TRANSFORM || op == OP_PROJECT) && i == 0))
+            return luaL_error(L, "instruction %d: unexpected matrix operand", pc);
+        }
+
+    /* result width */
+    w = 0;
+    switch(op)
+        {
+        case OP_MOV: case OP_NEG: case OP_ABS: case OP_SQRT: case OP_FLOOR: case OP_NORMALIZE:
+            w = v[0]->width; break;
+        case OP_LENGTH: w = 1; break;
+        case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_MIN: case OP_MAX:
+        case OP_MAD: case OP_CLAMP: case OP_MIX:
+            for(i = 0; i < nsrc; i++)
+                {
+                if(v[i]->width == 1 || v[i]->width == w) continue;
+                if(w > 1) return luaL_error(L, "instruction %d: operand widths mismatch", pc);
+                w = v[i]->width;
+                }
+            if(w == 0) w = 1;
+            break;
+        case OP_DOT:
+            if(v[0]->width != v[1]->width)
+                return luaL_error(L, "instruction %d: operand widths mismatch", pc);
+            w = 1; break;
+        case OP_CROSS:
+            if(v[0]->width != 3 || v[1]->width != 3)
+                return luaL_error(L, "instruction %d: 3-component operands expected", pc);
+            w = 3; break;
+        case OP_MXV:
+            if(v[0]->kind != V_MATRIX || v[0]->columns != v[1]->width)
+                return luaL_error(L, "instruction %d: matrix and vector sizes mismatch", pc);
+            w = v[0]->width; break;
+        case OP_TRANSFORM: case OP_PROJECT:
+            if(v[0]->kind != V_MATRIX || v[0]->width != 4 || v[0]->columns != 4 || v[1]->width != 3)
+                return luaL_error(L, "instruction %d: 4x4 matrix and 3-component vector expected", pc);
+            w = 3; break;
+        case OP_VEC:
+            for(i = 0; i < nsrc; i++) w += v[i]->width;
+            if(w > 4)
+                return luaL_error(L, "instruction %d: too many components", pc);
+            break;
+        case OP_SWIZZLE:
+            lua_rawgeti(L, -1, 4);
+            pattern = lua_tostring(L, -1);
+            w = pattern ? (int)strlen(pattern) : 0;
+            if(w < 1 || w > 4)
+                return luaL_error(L, "instruction %d: invalid swizzle pattern", pc);
+            for(j = 0; j < w; j++)
+                {
+                switch(pattern[j]) /* letters from a single set, as in GLSL */
+                    {
+#define C(c, index, s) case c: in->swizzle[j] = index; cur = s; break;
+                    C('x', 0, 1) C('y', 1, 1) C('z', 2, 1) C('w', 3, 1)
+                    C('r', 0, 2) C('g', 1, 2) C('b', 2, 2) C('a', 3, 2)
+                    C('s', 0, 3) C('t', 1, 3) C('p', 2, 3) C('q', 3, 3)
+#undef C
+                    default: in->swizzle[j] = 4; cur = 0;
+                    }
+                if(j == 0) set = cur;
+                if(in->swizzle[j] >= v[0]->width || cur != set)
+                    return luaL_error(L, "instruction %d: invalid swizzle pattern", pc);
+                }
+            lua_pop(L, 1);
+            break;
+        }
+
+    /* destination */
+    lua_rawgeti(L, -1, 1);
+    name = lua_tostring(L, -1);
+    if(!name || lua_type(L, -1) != LUA_TSTRING)
+        return luaL_error(L, "instruction %d: invalid destination", pc);
+    dst = FindVar(k, name);
+    if(dst < 0)
+        {
+        dst = k->nvars++;
+        d = &k->vars[dst];
+        d->name = Strdup(L, name);
+        d->kind = V_TEMP;
+        d->width = w;
+        }
+    d = &k->vars[dst];
+    if(d->kind != V_TEMP && d->kind != V_OUT)
+        return luaL_error(L, "instruction %d: '%s' cannot be assigned", pc, name);
+    if(d->width != w)
+        return luaL_error(L, "instruction %d: '%s' has %d components, not %d", pc, name, d->width, w);
+    d->defined = 1;
+    in->dst = dst;
+    lua_pop(L, 1);
+    return 0;
+    }
+
+static void Allocate(lua_State *L, kernel_t *k)
+    {
+    int i;
+    size_t n = 0;
+    double *p;
+    for(i = 0; i < k->nvars; i++)
+        {
+        switch(k->vars[i].kind)
+            {
+            case V_IN: case V_OUT: case V_TEMP: n += BLOCK*4; break;
+            case V_MATRIX: n += 16; break;
+            default: n += 4;
+            }
+        }
+    p = k->data = (double*)Malloc(L, n*sizeof(double));
+    for(i = 0; i < k->nvars; i++)
+        {
+        var_t *var = &k->vars[i];
+        var->data = p;
+        switch(var->kind)
+            {
+            case V_IN: case V_OUT: case V_TEMP: p += BLOCK*4; break;
+            case V_MATRIX: p += 16; break;
+            case V_CONST: var->data[0] = var->value; p += 4; break;
+            default: p += 4;
+            }
+        }
+    }
+
+/*------------------------------------------------------------------------------*
+ | Execution                                                                    |
+ *------------------------------------------------------------------------------*/
+
+static int IsPerElement(var_t *var)
+    {
+    return var->kind == V_IN || var->kind == V_OUT || var->kind == V_TEMP;
+    }
+
+static void Exec(kernel_t *k, instr_t *in, size_t n)
+/* Executes the instruction on n elements.
+ * The opcode is decoded once, and each case loops over the whole block. Elementwise
+ * operations write the destination directly (an operand aliasing the destination is 
+ * read at the same component before it is overwritten), the others go through r[].
+ */
+    {
+    size_t e;
+    int c, j, w, es[4], cs[4], off, w0, cols;
+    double r[4], s, *a[4], *p, *m;
+    var_t *d = &k->vars[in->dst];
+    w = d->width;
+    for(j = 0; j < in->nsrc; j++)
+        {
+        var_t *v = &k->vars[in->src[j]];
+        a[j] = v->data;
+        es[j] = IsPerElement(v) ? 4 : 0; /* element stride */
+        cs[j] = v->width == 1 ? 0 : 1;   /* component stride (broadcasts 1-component operands) */
+        }
+    w0 = in->nsrc > 0 ? k->vars[in->src[0]].width : 0;
+    cols = in->nsrc > 0 ? k->vars[in->src[0]].columns : 0;
+#define SRC(j, c) a[j][e*es[j] + (c)*cs[j]]
+#define ARG(j, c) a[j][e*es[j] + (c)]   /* no broadcast */
+#define DST(c) d->data[e*4 + (c)]
+#define ELEMENTWISE(expr) \
+    { for(e = 0; e < n; e++) for(c = 0; c < w; c++) DST(c) = (expr); } break
+#define STORE() do { p = &DST(0); for(c = 0; c < w; c++) p[c] = r[c]; } while(0)
+    switch(in->op)
+        {
+        case OP_MOV: ELEMENTWISE(SRC(0, c));
+        case OP_NEG: ELEMENTWISE(-SRC(0, c));
+        case OP_ABS: ELEMENTWISE(fabs(SRC(0, c)));
+        case OP_SQRT: ELEMENTWISE(sqrt(SRC(0, c)));
+        case OP_FLOOR: ELEMENTWISE(floor(SRC(0, c)));
+        case OP_ADD: ELEMENTWISE(SRC(0, c) + SRC(1, c));
+        case OP_SUB: ELEMENTWISE(SRC(0, c) - SRC(1, c));
+        case OP_MUL: ELEMENTWISE(SRC(0, c) * SRC(1, c));
+        case OP_DIV: ELEMENTWISE(SRC(0, c) / SRC(1, c));
+        case OP_MIN: ELEMENTWISE(fmin(SRC(0, c), SRC(1, c)));
+        case OP_MAX: ELEMENTWISE(fmax(SRC(0, c), SRC(1, c)));
+        case OP_MAD: ELEMENTWISE(SRC(0, c) * SRC(1, c) + SRC(2, c));
+        case OP_CLAMP: ELEMENTWISE(fmin(fmax(SRC(0, c), SRC(1, c)), SRC(2, c)));
+        case OP_MIX: ELEMENTWISE(SRC(0, c) + (SRC(1, c) - SRC(0, c)) * SRC(2, c));
+        case OP_LENGTH:
+            for(e = 0; e < n; e++)
+                {
+                s = 0;
+                for(c = 0; c < w0; c++) s += ARG(0, c) * ARG(0, c);
+                DST(0) = sqrt(s);
+                }
+            break;
+        case OP_DOT:
+            for(e = 0; e < n; e++)
+                {
+                s = 0;
+                for(c = 0; c < w0; c++) s += ARG(0, c) * ARG(1, c);
+                DST(0) = s;
+                }
+            break;
+        case OP_NORMALIZE:
+            for(e = 0; e < n; e++)
+                {
+                s = 0;
+                for(c = 0; c < w0; c++) s += ARG(0, c) * ARG(0, c);
+                s = (s > 0) ? 1.0/sqrt(s) : 0;
+                for(c = 0; c < w; c++) DST(c) = ARG(0, c) * s;
+                }
+            break;
+        case OP_CROSS:
+            for(e = 0; e < n; e++)
+                {
+                r[0] = ARG(0, 1)*ARG(1, 2) - ARG(0, 2)*ARG(1, 1);
+                r[1] = ARG(0, 2)*ARG(1, 0) - ARG(0, 0)*ARG(1, 2);
+                r[2] = ARG(0, 0)*ARG(1, 1) - ARG(0, 1)*ARG(1, 0);
+                STORE();
+                }
+            break;
+        case OP_MXV:
+            for(e = 0; e < n; e++)
+                {
+                m = &ARG(0, 0);
+                for(c = 0; c < w; c++)
+                    {
+                    s = 0;
+                    for(j = 0; j < cols; j++) s += m[c*4 + j] * SRC(1, j);
+                    r[c] = s;
+                    }
+                STORE();
+                }
+            break;
+        case OP_TRANSFORM:
+        case OP_PROJECT:
+            for(e = 0; e < n; e++)
+                {
+                m = &ARG(0, 0);
+                for(c = 0; c < 4; c++)
+                    r[c] = m[c*4]*ARG(1, 0) + m[c*4+1]*ARG(1, 1) + m[c*4+2]*ARG(1, 2) + m[c*4+3];
+                if(in->op == OP_PROJECT)
+                    { s = 1.0/r[3]; r[0] *= s; r[1] *= s; r[2] *= s; }
+                STORE();
+                }
+            break;
+        case OP_VEC:
+            for(e = 0; e < n; e++)
+                {
+                off = 0;
+                for(j = 0; j < in->nsrc; j++)
+                    for(c = 0; c < k->vars[in->src[j]].width; c++) r[off++] = ARG(j, c);
+                STORE();
+                }
+            break;
+        case OP_SWIZZLE:
+            for(e = 0; e < n; e++)
+                {
+                for(c = 0; c < w; c++) r[c] = ARG(0, in->swizzle[c]);
+                STORE();
+                }
+            break;
+        }
+#undef STORE
+#undef ELEMENTWISE
+#undef DST
+#undef ARG
+#undef SRC
+    }
+
+/*------------------------------------------------------------------------------*
+ | Lua functions                                                                |
+ *------------------------------------------------------------------------------*/
+
+static int freekernel(lua_State *L, ud_t *ud)
+    {
+    int i;
+    kernel_t *k = (kernel_t*)ud->handle;
+    if(!freeuserdata(L, ud, "kernel")) return 0;
+    for(i = 0; i < k->nvars; i++)
+        Free(L, k->vars[i].name);
+    Free(L, k->vars);
+    Free(L, k->instr);
+    Free(L, k->data);
+    Free(L, k->ptr);
+    Free(L, k);
+    return 0;
+    }
+
+static int Create(lua_State *L)
+/* kernel(decls, code) 
+ * decls = { name = spec }
+ * code = { { dst, opname, src1, ... }, ... }
+ */
+    {
+    ud_t *ud;
+    kernel_t *k;
+    int i, ninstr, maxvars;
+    luaL_checktype(L, 1, LUA_TTABLE);
+    luaL_checktype(L, 2, LUA_TTABLE);
+    ninstr = (int)luaL_len(L, 2);
+    if(ninstr < 1)
+        return luaL_argerror(L, 2, "empty code");
+    maxvars = 5*ninstr; /* each instruction can introduce a temporary and up to 4 literals */
+    lua_pushnil(L);
+    while(lua_next(L, 1)) { maxvars++; lua_pop(L, 1); }
+    k = (kernel_t*)Malloc(L, sizeof(kernel_t));
+    ud = newuserdata(L, k, KERNEL_MT, "kernel");
+    ud->destructor = freekernel;
+    k->vars = (var_t*)Malloc(L, maxvars*sizeof(var_t));
+    k->instr = (instr_t*)Malloc(L, ninstr*sizeof(instr_t));
+    /* declarations */
+    lua_pushnil(L);
+    while(lua_next(L, 1))
+        {
+        if(lua_type(L, -2) != LUA_TSTRING || lua_type(L, -1) != LUA_TSTRING)
+            return luaL_argerror(L, 1, "invalid declaration");
+        ParseDecl(L, lua_tostring(L, -2), lua_tostring(L, -1), &k->vars[k->nvars]);
+        k->vars[k->nvars].name = Strdup(L, lua_tostring(L, -2));
+        k->vars[k->nvars].defined = (k->vars[k->nvars].kind != V_OUT);
+        k->nvars++;
+        lua_pop(L, 1);
+        }
+    /* code */
+    for(i = 1; i <= ninstr; i++)
+        {
+        lua_rawgeti(L, 2, i);
+        Compile(L, k, i);
+        k->ninstr = i;
+        lua_pop(L, 1);
+        }
+    for(i = 0; i < k->nvars; i++)
+        if(k->vars[i].kind == V_OUT && !k->vars[i].defined)
+            return luaL_error(L, "output '%s' is never assigned", k->vars[i].name);
+    Allocate(L, k);
+    k->ptr = (char**)Malloc(L, k->nvars*sizeof(char*));
+    return 1;
+    }
+
+static int Run(lua_State *L)
+/* kernel:run(bindings, [count], [type]) */
+    {
+    int i, j, c;
+    size_t n, e, base, count = (size_t)-1;
+    char **ptr;
+    var_t *var;
+    hostmem_t *hostmem;
+    kernel_t *k = checkkernel(L, 1, NULL);
+    int type = checkrealtype(L, 4);
+    size_t sz = sizeoftype(type);
+    mat_t m;
+    size_t nr, nc;
+    vec_t v;
+    luaL_checktype(L, 2, LUA_TTABLE);
+    ptr = k->ptr;
+    /* bind arrays */
+    for(i = 0; i < k->nvars; i++)
+        {
+        var = &k->vars[i];
+        ptr[i] = NULL;
+        if(var->kind != V_IN && var->kind != V_OUT) continue;
+        lua_getfield(L, 2, var->name);
+        hostmem = testhostmem(L, -1, NULL);
+        if(!hostmem)
+            return luaL_error(L, "'%s': hostmem expected", var->name);
+        ptr[i] = hostmem->ptr;
+        n = hostmem->size / (var->width*sz);
+        if(n < count) count = n;
+        lua_pop(L, 1);
+        }
+    if(!lua_isnoneornil(L, 3))
+        {
+        lua_Integer cnt = luaL_checkinteger(L, 3);
+        if(cnt < 0)
+            return luaL_argerror(L, 3, errstring(ERR_VALUE));
+        if((size_t)cnt > count)
+            return luaL_error(L, errstring(ERR_BOUNDARIES));
+        count = (size_t)cnt;
+        }
+    if(count == (size_t)-1)
+        return luaL_error(L, "kernel has no arrays");
+    /* bind uniforms */
+    for(i = 0; i < k->nvars; i++)
+        {
+        var = &k->vars[i];
+        if(var->kind == V_UNIFORM)
+            {
+            lua_getfield(L, 2, var->name);
+            if(var->width == 1)
+                var->data[0] = luaL_checknumber(L, -1);
+            else
+                {
+                if(!testvec(L, -1, v, &n, NULL) || (int)n != var->width)
+                    return luaL_error(L, "'%s': vec%d expected", var->name, var->width);
+                for(c = 0; c < var->width; c++) var->data[c] = v[c];
+                }
+            lua_pop(L, 1);
+            }
+        else if(var->kind == V_MATRIX)
+            {
+            lua_getfield(L, 2, var->name);
+            if(!testmat(L, -1, m, &nr, &nc) || (int)nr != var->width || (int)nc != var->columns)
+                return luaL_error(L, "'%s': %dx%d matrix expected", var->name, var->width, var->columns);
+            for(c = 0; c < 4; c++)
+                for(j = 0; j < 4; j++)
+                    var->data[c*4 + j] = m[c][j];
+            lua_pop(L, 1);
+            }
+        }
+    /* execute */
+    for(base = 0; base < count; base += BLOCK)
+        {
+        n = (count - base) < BLOCK ? (count - base) : BLOCK;
+        for(i = 0; i < k->nvars; i++)
+            {
+            var = &k->vars[i];
+            if(var->kind != V_IN) continue;
+            for(e = 0; e < n; e++)
+                for(c = 0; c < var->width; c++)
+                    var->data[e*4 + c] = getreal(ptr[i], type, (base + e)*var->width + c);
+            }
+        for(j = 0; j < k->ninstr; j++)
+            Exec(k, &k->instr[j], n);
+        for(i = 0; i < k->nvars; i++)
+            {
+            var = &k->vars[i];
+            if(var->kind != V_OUT) continue;
+            for(e = 0; e < n; e++)
+                for(c = 0; c < var->width; c++)
+                    setreal(ptr[i], type, (base + e)*var->width + c, var->data[e*4 + c]);
+            }
+        }
+    lua_pushinteger(L, count);
+    return 1;
+    }
+
+RAW_FUNC(kernel)
+TYPE_FUNC(kernel)
+DELETE_FUNC(kernel)
+
+static const struct luaL_Reg Methods[] = 
+    {
+        { "raw", Raw },
+        { "type", Type },
+        { "free", Delete },
+        { "run", Run },
+        { NULL, NULL } /* sentinel */
+    };
+
+static const struct luaL_Reg MetaMethods[] = 
+    {
+        { "__gc",  Delete },
+        { NULL, NULL } /* sentinel */
+    };
+
+static const struct luaL_Reg Functions[] = 
+    {
+        { "kernel", Create },
+        { NULL, NULL } /* sentinel */
+    };
+
+void moonglmath_open_kernel(lua_State *L)
+    {
+    udata_define(L, KERNEL_MT, Methods, MetaMethods);
+    luaL_setfuncs(L, Functions, 0);
+    }
+
@@ -0,0 +1,480 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Stefano Trettel
+ *
+ * Software repository: MoonGLMATH, https://github.com/stetre/moonglmath
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "internal.h"
+
+/* Vertex layouts.
+ *
+ * A layout describes the attributes of the vertices in an interleaved vertex buffer,
+ * i.e. a sequence of count elements of stride bytes each, where each attribute occupies
+ * the same offset in every element. The layout is used to pack per-attribute values into
+ * such a buffer (interleave) and to extract them from it (deinterleave).
+ */
+
+#define MAXSIZE 16 /* max no. of components per attribute */
+
+typedef struct {
+    char *name;
+    int type;       /* as declared */
+    int enctype;    /* type actually used for encoding (differs for normalized integers) */
+    int size;       /* no. of components */
+    int normalized;
+    int integer;    /* non-normalized integer type: values are checked as in pack() */
+    size_t offset;
+    size_t nbytes;
+} attrib_t;
+
+struct moonglmath_layout_s {
+    int nattribs;
+    attrib_t *attribs;
+    size_t stride;
+};
+
+static int EncodingType(lua_State *L, attrib_t *a)
+    {
+    switch(a->type)
+        {
+        case MOONGLMATH_TYPE_SNORM8:
+        case MOONGLMATH_TYPE_UNORM8:
+        case MOONGLMATH_TYPE_SNORM16:
+        case MOONGLMATH_TYPE_UNORM16:
+            a->normalized = 1;
+            return a->type;
+        case MOONGLMATH_TYPE_SNORM_2_10_10_10:
+        case MOONGLMATH_TYPE_UNORM_2_10_10_10:
+            if(a->size != 4)
+                return luaL_error(L, "'%s': size must be 4 for this type", a->name);
+            a->normalized = 1;
+            return a->type;
+        case MOONGLMATH_TYPE_CHAR: return a->normalized ? MOONGLMATH_TYPE_SNORM8 : a->type;
+        case MOONGLMATH_TYPE_UCHAR: return a->normalized ? MOONGLMATH_TYPE_UNORM8 : a->type;
+        case MOONGLMATH_TYPE_SHORT: return a->normalized ? MOONGLMATH_TYPE_SNORM16 : a->type;
+        case MOONGLMATH_TYPE_USHORT: return a->normalized ? MOONGLMATH_TYPE_UNORM16 : a->type;
+        case MOONGLMATH_TYPE_INT:
+        case MOONGLMATH_TYPE_UINT:
+        case MOONGLMATH_TYPE_LONG:
+        case MOONGLMATH_TYPE_ULONG:
+            if(a->normalized)
+                return luaL_error(L, "'%s': normalized not supported for this type", a->name);
+            return a->type;
+        default: /* floating point: 'normalized' is meaningless */
+            a->normalized = 0;
+            return a->type;
+        }
+    return a->type;
+    }
+
+static int IsInteger(int enctype)
+    {
+    switch(enctype)
+        {
+        case MOONGLMATH_TYPE_CHAR: case MOONGLMATH_TYPE_UCHAR:
+        case MOONGLMATH_TYPE_SHORT: case MOONGLMATH_TYPE_USHORT:
+        case MOONGLMATH_TYPE_INT: case MOONGLMATH_TYPE_UINT:
+        case MOONGLMATH_TYPE_LONG: case MOONGLMATH_TYPE_ULONG:
+            return 1;
+        default:
+            return 0;
+        }
+    }
+
+static void EncodeIntegers(int type, const lua_Integer *src, int n, void *dst)
+/* Same conversion as pack() for integer types (a cast from lua_Integer) */
+    {
+    int i;
+    switch(type)
+        {
+#define E(T) do { T *d = (T*)dst; for(i = 0; i < n; i++) d[i] = (T)src[i]; } while(0)
+        case MOONGLMATH_TYPE_CHAR:   E(int8_t); break;
+        case MOONGLMATH_TYPE_UCHAR:  E(uint8_t); break;
+        case MOONGLMATH_TYPE_SHORT:  E(int16_t); break;
+        case MOONGLMATH_TYPE_USHORT: E(uint16_t); break;
+        case MOONGLMATH_TYPE_INT:    E(int32_t); break;
+        case MOONGLMATH_TYPE_UINT:   E(uint32_t); break;
+        case MOONGLMATH_TYPE_LONG:   E(int64_t); break;
+        case MOONGLMATH_TYPE_ULONG:  E(uint64_t); break;
+        default: break;
+#undef E
+        }
+    }
+
+static int ToInteger(double x, lua_Integer *i)
+/* Same as lua_tointegerx() for a float: fails if x has no exact integer representation */
+    {
+    if(!(x >= -9223372036854775808.0 && x < 9223372036854775808.0) || floor(x) != x)
+        return 0;
+    *i = (lua_Integer)x;
+    return 1;
+    }
+
+static int FindAttrib(layout_t *layout, const char *name)
+    {
+    int i;
+    for(i = 0; i < layout->nattribs; i++)
+        if(strcmp(layout->attribs[i].name, name) == 0) return i;
+    return -1;
+    }
+
+static attrib_t *CheckAttrib(lua_State *L, int arg, layout_t *layout)
+/* Checks an attribute given by name or by (1-based) index */
+    {
+    int i;
+    if(lua_type(L, arg) == LUA_TSTRING)
+        i = FindAttrib(layout, lua_tostring(L, arg));
+    else
+        i = (int)luaL_checkinteger(L, arg) - 1;
+    if(i < 0 || i >= layout->nattribs)
+        { luaL_argerror(L, arg, errstring(ERR_VALUE)); return NULL; }
+    return &layout->attribs[i];
+    }
+
+/*------------------------------------------------------------------------------*
+ | Lua functions                                                                |
+ *------------------------------------------------------------------------------*/
+
+static int freelayout(lua_State *L, ud_t *ud)
+    {
+    int i;
+    layout_t *layout = (layout_t*)ud->handle;
+    if(!freeuserdata(L, ud, "layout")) return 0;
+    for(i = 0; i < layout->nattribs; i++)
+        Free(L, layout->attribs[i].name);
+    Free(L, layout->attribs);
+    Free(L, layout);
+    return 0;
+    }
+
+static int Create(lua_State *L)
+/* layout(attributes, [stride])
+ * attributes = { { name=, type=, size=, normalized=, offset= }, ... }
+ */
+    {
+    ud_t *ud;
+    layout_t *layout;
+    attrib_t *a;
+    int i, n, isnum;
+    size_t end, next = 0, minstride = 0;
+    lua_Integer stride = luaL_optinteger(L, 2, -1);
+    luaL_checktype(L, 1, LUA_TTABLE);
+    n = (int)luaL_len(L, 1);
+    if(n < 1)
+        return luaL_argerror(L, 1, "no attributes");
+    layout = (layout_t*)Malloc(L, sizeof(layout_t));
+    ud = newuserdata(L, layout, LAYOUT_MT, "layout");
+    ud->destructor = freelayout;
+    layout->attribs = (attrib_t*)Malloc(L, n*sizeof(attrib_t));
+    for(i = 0; i < n; i++)
+        {
+        a = &layout->attribs[i];
+        if(lua_rawgeti(L, 1, i+1) != LUA_TTABLE)
+            return luaL_error(L, "attribute %d: table expected", i+1);
+        if(lua_getfield(L, -1, "name") != LUA_TSTRING)
+            return luaL_error(L, "attribute %d: missing or invalid name", i+1);
+        if(FindAttrib(layout, lua_tostring(L, -1)) >= 0)
+            return luaL_error(L, "attribute %d: duplicate name '%s'", i+1, lua_tostring(L, -1));
+        a->name = Strdup(L, lua_tostring(L, -1));
+        layout->nattribs++;
+        lua_pop(L, 1);
+        lua_getfield(L, -1, "type");
+        a->type = lua_isnil(L, -1) ? MOONGLMATH_TYPE_FLOAT : checktype(L, -1);
+        lua_pop(L, 1);
+        lua_getfield(L, -1, "size");
+        a->size = (int)lua_tointegerx(L, -1, &isnum);
+        if(!isnum || a->size < 1 || a->size > MAXSIZE)
+            return luaL_error(L, "'%s': invalid size", a->name);
+        lua_pop(L, 1);
+        lua_getfield(L, -1, "normalized");
+        a->normalized = lua_toboolean(L, -1);
+        lua_pop(L, 1);
+        a->enctype = EncodingType(L, a);
+        a->integer = IsInteger(a->enctype);
+        a->nbytes = sizeofvalues(a->enctype, a->size);
+        lua_getfield(L, -1, "offset");
+        if(lua_isnil(L, -1))
+            a->offset = next;
+        else
+            {
+            lua_Integer offset = lua_tointegerx(L, -1, &isnum);
+            if(!isnum || offset < 0)
+                return luaL_error(L, "'%s': invalid offset", a->name);
+            a->offset = (size_t)offset;
+            }
+        lua_pop(L, 2);
+        next = end = a->offset + a->nbytes;
+        if(end > minstride) minstride = end;
+        }
+    if(stride < 0)
+        layout->stride = minstride;
+    else if((size_t)stride < minstride)
+        return luaL_argerror(L, 2, "stride too small for the attributes");
+    else
+        layout->stride = (size_t)stride;
+    return 1;
+    }
+
+static int Stride(lua_State *L)
+    {
+    layout_t *layout = checklayout(L, 1, NULL);
+    lua_pushinteger(L, layout->stride);
+    return 1;
+    }
+
+static int Size(lua_State *L)
+/* size([count=1]) */
+    {
+    layout_t *layout = checklayout(L, 1, NULL);
+    lua_Integer count = luaL_optinteger(L, 2, 1);
+    if(count < 0)
+        return luaL_argerror(L, 2, errstring(ERR_VALUE));
+    lua_pushinteger(L, count * layout->stride);
+    return 1;
+    }
+
+static int Attributes(lua_State *L)
+    {
+    int i;
+    layout_t *layout = checklayout(L, 1, NULL);
+    lua_newtable(L);
+    for(i = 0; i < layout->nattribs; i++)
+        {
+        lua_pushstring(L, layout->attribs[i].name);
+        lua_rawseti(L, -2, i+1);
+        }
+    return 1;
+    }
+
+static int Attribute(lua_State *L)
+/* name, type, size, normalized, offset = attribute(name | index) */
+    {
+    layout_t *layout = checklayout(L, 1, NULL);
+    attrib_t *a = CheckAttrib(L, 2, layout);
+    lua_pushstring(L, a->name);
+    pushtype(L, a->type);
+    lua_pushinteger(L, a->size);
+    lua_pushboolean(L, a->normalized);
+    lua_pushinteger(L, a->offset);
+    return 5;
+    }
+
+static size_t SourceCount(lua_State *L, attrib_t *a, int type)
+/* Returns the number of vertices in the source on top of the stack (hostmem or table) */
+    {
+    size_t n;
+    hostmem_t *hostmem = testhostmem(L, -1, NULL);
+    if(hostmem)
+        return hostmem->size / (a->size * sizeoftype(type));
+    if(lua_type(L, -1) != LUA_TTABLE)
+        return luaL_error(L, "'%s': table or hostmem expected", a->name);
+    n = toflattable(L, lua_gettop(L)); /* replaces the source with its flat version */
+    lua_remove(L, -2);
+    if((n % a->size) != 0)
+        return luaL_error(L, "'%s': %s", a->name, errstring(ERR_LENGTH));
+    return n / a->size;
+    }
+
+static int Interleave(lua_State *L)
+/* interleave(sources, dst, [count], [type])
+ * sources = { name = table | hostmem }
+ */
+    {
+    int i, c, isnum, base, src, nsrc = 0;
+    size_t v, n, count = (size_t)-1;
+    double buf[MAXSIZE];
+    lua_Integer ibuf[MAXSIZE];
+    double tmp[MAXSIZE]; /* encoded values take at most sizeof(double) bytes each */
+    char *dst, *p;
+    attrib_t *a;
+    hostmem_t *hostmem;
+    layout_t *layout = checklayout(L, 1, NULL);
+    int type = checkrealtype(L, 5);
+    lua_Integer cnt = luaL_optinteger(L, 4, -1);
+    if(!lua_isnoneornil(L, 4) && cnt < 0)
+        return luaL_argerror(L, 4, errstring(ERR_VALUE));
+    luaL_checktype(L, 2, LUA_TTABLE);
+    lua_settop(L, 5);
+    luaL_checkstack(L, layout->nattribs + 4, NULL);
+    /* push the sources (in attribute order, nil if not given) and find the count */
+    base = lua_gettop(L) + 1;
+    for(i = 0; i < layout->nattribs; i++)
+        {
+        a = &layout->attribs[i];
+        if(lua_getfield(L, 2, a->name) == LUA_TNIL) continue;
+        n = SourceCount(L, a, type);
+        if(n < count) count = n;
+        nsrc++;
+        }
+    if(nsrc == 0)
+        return luaL_argerror(L, 2, "no sources");
+    if(cnt >= 0)
+        {
+        if((size_t)cnt > count)
+            return luaL_error(L, errstring(ERR_BOUNDARIES));
+        count = (size_t)cnt;
+        }
+    dst = checkhostmemarray(L, 3, 0, layout->stride, &count);
+    for(i = 0; i < layout->nattribs; i++)
+        {
+        a = &layout->attribs[i];
+        src = base + i;
+        if(lua_isnil(L, src)) continue;
+        p = dst + a->offset;
+        hostmem = testhostmem(L, src, NULL);
+        for(v = 0; v < count; v++, p += layout->stride)
+            {
+            if(a->integer)
+                {
+                for(c = 0; c < a->size; c++)
+                    {
+                    if(hostmem)
+                        isnum = ToInteger(getreal(hostmem->ptr, type, v*a->size + c), &ibuf[c]);
+                    else
+                        {
+                        lua_rawgeti(L, src, v*a->size + c + 1);
+                        ibuf[c] = lua_tointegerx(L, -1, &isnum);
+                        lua_pop(L, 1);
+                        }
+                    if(!isnum)
+                        return luaL_error(L, "'%s': %s", a->name, errstring(ERR_TYPE));
+                    }
+                EncodeIntegers(a->enctype, ibuf, a->size, tmp);
+                memcpy(p, tmp, a->nbytes);
+                continue;
+                }
+            if(hostmem)
+                for(c = 0; c < a->size; c++)
+                    buf[c] = getreal(hostmem->ptr, type, v*a->size + c);
+            else
+                for(c = 0; c < a->size; c++)
+                    {
+                    lua_rawgeti(L, src, v*a->size + c + 1);
+                    buf[c] = lua_tonumberx(L, -1, &isnum);
+                    if(!isnum)
+                        return luaL_error(L, "'%s': %s", a->name, errstring(ERR_TYPE));
+                    lua_pop(L, 1);
+                    }
+            encodevalues(a->enctype, buf, a->size, tmp); /* tmp is aligned, p may be not */
+            memcpy(p, tmp, a->nbytes);
+            }
+        }
+    lua_pushinteger(L, count);
+    return 1;
+    }
+
+static int Deinterleave(lua_State *L)
+/* dsts = deinterleave(src, [dsts], [count], [type])
+ * dsts = { name = table | hostmem }
+ */
+    {
+    int i, c, dsts;
+    size_t v, count;
+    double buf[MAXSIZE];
+    double tmp[MAXSIZE]; /* encoded values take at most sizeof(double) bytes each */
+    char *src, *p, *q;
+    attrib_t *a;
+    layout_t *layout = checklayout(L, 1, NULL);
+    int type = checkrealtype(L, 5);
+    src = checkhostmemarray(L, 2, 4, layout->stride, &count);
+    if(lua_isnoneornil(L, 3))
+        {
+        lua_newtable(L);
+        for(i = 0; i < layout->nattribs; i++)
+            {
+            lua_newtable(L);
+            lua_setfield(L, -2, layout->attribs[i].name);
+            }
+        }
+    else
+        {
+        luaL_checktype(L, 3, LUA_TTABLE);
+        lua_pushvalue(L, 3);
+        }
+    dsts = lua_gettop(L);
+    for(i = 0; i < layout->nattribs; i++)
+        {
+        a = &layout->attribs[i];
+        q = NULL;
+        switch(lua_getfield(L, dsts, a->name))
+            {
+            case LUA_TNIL: lua_pop(L, 1); continue;
+            case LUA_TTABLE: break;
+            default:
+                q = checkhostmemarray(L, -1, 0, a->size * sizeoftype(type), &count);
+            }
+        p = src + a->offset;
+        for(v = 0; v < count; v++, p += layout->stride)
+            {
+            memcpy(tmp, p, a->nbytes);
+            decodevalues(a->enctype, tmp, a->size, buf);
+            if(q)
+                for(c = 0; c < a->size; c++)
+                    setreal(q, type, v*a->size + c, buf[c]);
+            else
+                for(c = 0; c < a->size; c++)
+                    {
+                    lua_pushnumber(L, buf[c]);
+                    lua_rawseti(L, -2, v*a->size + c + 1);
+                    }
+            }
+        lua_pop(L, 1);
+        }
+    return 1;
+    }
+
+RAW_FUNC(layout)
+TYPE_FUNC(layout)
+DELETE_FUNC(layout)
+
+static const struct luaL_Reg Methods[] = 
+    {
+        { "raw", Raw },
+        { "type", Type },
+        { "free", Delete },
+        { "stride", Stride },
+        { "size", Size },
+        { "attributes", Attributes },
+        { "attribute", Attribute },
+        { "interleave", Interleave },
+        { "deinterleave", Deinterleave },
+        { NULL, NULL } /* sentinel */
+    };
+
+static const struct luaL_Reg MetaMethods[] = 
+    {
+        { "__gc",  Delete },
+        { NULL, NULL } /* sentinel */
+    };
+
+static const struct luaL_Reg Functions[] = 
+    {
+        { "layout", Create },
+        { NULL, NULL } /* sentinel */
+    };
+
+void moonglmath_open_layout(lua_State *L)
+    {
+    udata_define(L, LAYOUT_MT, Methods, MetaMethods);
+    luaL_setfuncs(L, Functions, 0);
+    }
+
@@ -65,10 +65,21 @@ int luaopen_moonglmath(lua_State *L)
     moonglmath_open_mat(L);
     moonglmath_open_quat(L);
     moonglmath_open_complex(L);
+    moonglmath_open_dualquat(L);
     moonglmath_open_funcs(L);
+    moonglmath_open_pool(L);
     moonglmath_open_transform(L);
     moonglmath_open_viewing(L);
+    moonglmath_open_raycast(L);
     moonglmath_open_hostmem(L);
+    moonglmath_open_grid(L);
+    moonglmath_open_hierarchy(L);
+    moonglmath_open_fft(L);
+    moonglmath_open_kernel(L);
+    moonglmath_open_layout(L);
+    moonglmath_open_matstack(L);
+    moonglmath_open_camera(L);
+    moonglmath_open_api(L);
 
     /* Add functions implemented in Lua */
     lua_pushvalue(L, -1); lua_setglobal(L, "moonglmath");
@@ -34,7 +34,7 @@ int testmat(lua_State *L, int arg, mat_t m, size_t *nr, size_t *nc)
     {
     int row;
     size_t i, j, nr_, nc_;
-    if(!testmetatable(L, arg, MAT_MT))
+    if(typetag(L, arg) != TAG_MAT)
         return 0;
 
     lua_getfield(L, arg, "rows");   
@@ -75,33 +75,74 @@ int checkmat(lua_State *L, int arg, mat_t m, size_t *nr, size_t *nc)
     return 1;
     }
 
+static int ShapeKey[5][5]; /* registry[&ShapeKey[nr][nc]] = shape metatable (nr,nc=2,3,4) */
+
+static void setshapemetatable(lua_State *L, size_t nr, size_t nc)
+/* Sets the metatable for the given shape to the table on top of the stack */
+    {
+    if(nr < 2 || nc < 2)
+        luaL_getmetatable(L, MAT_MT);
+    else
+        lua_rawgetp(L, LUA_REGISTRYINDEX, &ShapeKey[nr][nc]);
+    lua_setmetatable(L, -2);
+    }
+
 int pushmat(lua_State *L, mat_t m, size_t mr, size_t mc, size_t nr, size_t nc)
 /* mr, mc = no. of valid colums/rows in m
  */
     {
-    size_t i, j;
+    size_t i, j, oldnr, oldnc;
     checkmatsize(L, nr, nc);
-    lua_newtable(L);
-    setmetatable(L, MAT_MT);
-    for(i=0; i<nr; i++)
+    if(pooltake(L, POOL_MAT)) /* recycled matrix: overwrite rows, clearing stale values */
         {
-        lua_newtable(L); /* row i+1 */
-        for(j=0; j<nc; j++)
+        lua_getfield(L, -1, "rows");
+        oldnr = lua_tointeger(L, -1);
+        lua_getfield(L, -2, "columns");
+        oldnc = lua_tointeger(L, -1);
+        lua_pop(L, 2);
+        for(i=0; i<4; i++)
             {
-            lua_pushnumber(L, (i < mr) && (j < mc) ? m[i][j] : 0);
-            lua_seti(L, -2, j+1);
+            lua_rawgeti(L, -1, i+1);
+            for(j=0; j<nc && i<nr; j++)
+                {
+                lua_pushnumber(L, (i < mr) && (j < mc) ? m[i][j] : 0);
+                lua_rawseti(L, -2, j+1);
+                }
+            for(j = (i<nr ? nc : 0); j<oldnc && i<oldnr; j++)
+                {
+                lua_pushnil(L);
+                lua_rawseti(L, -2, j+1);
+                }
+            lua_pop(L, 1);
             }
-        lua_seti(L, -2, i+1);
         }
-    for(i=nr; i<4; i++)
+    else
         {
-        lua_newtable(L); /* empty rows */
-        lua_seti(L, -2, i+1);
+        lua_createtable(L, 4, 2);
+        for(i=0; i<nr; i++)
+            {
+            lua_createtable(L, nc, 0); /* row i+1 */
+            for(j=0; j<nc; j++)
+                {
+                lua_pushnumber(L, (i < mr) && (j < mc) ? m[i][j] : 0);
+                lua_rawseti(L, -2, j+1);
+                }
+            lua_rawseti(L, -2, i+1);
+            }
+        for(i=nr; i<4; i++)
+            {
+            lua_newtable(L); /* empty rows */
+            lua_rawseti(L, -2, i+1);
+            }
         }
+    setshapemetatable(L, nr, nc);
+    /* raw sets, not to go through the __newindex metamethod */
+    lua_pushliteral(L, "rows");
     lua_pushinteger(L, nr);
-    lua_setfield(L, -2, "rows");
+    lua_rawset(L, -3);
+    lua_pushliteral(L, "columns");
     lua_pushinteger(L, nc);
-    lua_setfield(L, -2, "columns");
+    lua_rawset(L, -3);
     return 1;
     }
 
@@ -482,10 +523,72 @@ void mat_adj(mat_t dst, mat_t m, size_t n)
         }
     }
 
+int mat_isaffine(mat_t m)
+/* Checks if the 4x4 matrix m is affine, i.e. if its last row is (0, 0, 0, 1) */
+    {
+    return (m[3][0] == 0) && (m[3][1] == 0) && (m[3][2] == 0) && (m[3][3] == 1);
+    }
+
+int mat_affine_inv(mat_t dst, mat_t m)
+/* Inverse of an affine 4x4 matrix m = | A t |, i.e. | A^-1  -A^-1*t |
+ *                                     | 0 1 |       |  0       1    |
+ * (m and dst may not overlap).
+ */
+    {
+    size_t i, j;
+    double d = det3(m);
+    if(d == 0.0)
+        return 0;
+    mat_adj(dst, m, 3);
+    for(i=0; i<3; i++)
+        for(j=0; j<3; j++)
+            dst[i][j] /= d;
+    for(i=0; i<3; i++)
+        dst[i][3] = -(dst[i][0]*m[0][3] + dst[i][1]*m[1][3] + dst[i][2]*m[2][3]);
+    dst[3][0] = dst[3][1] = dst[3][2] = 0;
+    dst[3][3] = 1;
+    return 1;
+    }
+
+void mat_rigid_inv(mat_t dst, mat_t m)
+/* Inverse of a rigid 4x4 matrix m = | R t | (with R orthonormal), i.e. | R^T  -R^T*t |
+ *                                   | 0 1 |                            |  0     1    |
+ * (m and dst may not overlap).
+ */
+    {
+    size_t i, j;
+    for(i=0; i<3; i++)
+        for(j=0; j<3; j++)
+            dst[i][j] = m[j][i];
+    for(i=0; i<3; i++)
+        dst[i][3] = -(m[0][i]*m[0][3] + m[1][i]*m[1][3] + m[2][i]*m[2][3]);
+    dst[3][0] = dst[3][1] = dst[3][2] = 0;
+    dst[3][3] = 1;
+    }
+
+void mat_affine_mul(mat_t dst, mat_t m1, mat_t m2)
+/* dst = m1 * m2, for affine 4x4 matrices (the last row is assumed to be (0, 0, 0, 1)).
+ * (dst may not overlap with m1 or m2).
+ */
+    {
+    size_t i;
+    for(i=0; i<3; i++)
+        {
+        dst[i][0] = m1[i][0]*m2[0][0] + m1[i][1]*m2[1][0] + m1[i][2]*m2[2][0];
+        dst[i][1] = m1[i][0]*m2[0][1] + m1[i][1]*m2[1][1] + m1[i][2]*m2[2][1];
+        dst[i][2] = m1[i][0]*m2[0][2] + m1[i][1]*m2[1][2] + m1[i][2]*m2[2][2];
+        dst[i][3] = m1[i][0]*m2[0][3] + m1[i][1]*m2[1][3] + m1[i][2]*m2[2][3] + m1[i][3];
+        }
+    dst[3][0] = dst[3][1] = dst[3][2] = 0;
+    dst[3][3] = 1;
+    }
+
 int mat_inv(mat_t dst, mat_t m, size_t n)
     {
     size_t i, j;
     double d;
+    if((n==4) && mat_isaffine(m))
+        return mat_affine_inv(dst, m);
     if(n==2)
         d = det2(m);
     else if(n==3)
@@ -630,7 +733,7 @@ static int Mxv(lua_State *L) /* MxN * Nx1 = N*1 (column vector)*/
             s += (m[i][j] * v[j]);
         v1[i] = s;
         }
-    return pushvec(L, v1, size, size, 0);
+    return pushvec(L, v1, nr, nr, 0);
     }
 
 
@@ -650,6 +753,11 @@ static int Mul(lua_State *L)
     checkmat(L, 2, m2, &nr2, &nc2);
     if((nc1 != nr2))
         return luaL_error(L, OPERANDS_ERROR);
+    if((nr1 == 4) && (nc1 == 4) && (nc2 == 4) && mat_isaffine(m1) && mat_isaffine(m2))
+        {
+        mat_affine_mul(m, m1, m2);
+        return pushmat(L, m, 4, 4, 4, 4);
+        }
     for(i=0; i < nr1; i++)
         for(j=0; j < nc2; j++)
             {
@@ -675,6 +783,187 @@ static int Div(lua_State *L)
     return pushmat(L, m, nr, nc, nr, nc);
     }
 
+/*------------------------------------------------------------------------------*
+ | Shape metatables                                                             |
+ *------------------------------------------------------------------------------*/
+
+/* Each matrix shape (mat2, mat3, mat4, mat2x3, ...) has its own metatable, a copy of the
+ * MAT_MT one whose arithmetic metamethods are specialized for that shape (see vec.c).
+ * Upvalue 1 is the shape metatable, and upvalue 2 is the metatable of the column vectors
+ * that can right-multiply the matrix. Anything else is handled by the generic metamethods.
+ */
+
+static int SameShape(lua_State *L, int arg, int upvalue)
+    {
+    int ok;
+    if(!lua_getmetatable(L, arg)) return 0;
+    ok = lua_rawequal(L, -1, lua_upvalueindex(upvalue));
+    lua_pop(L, 1);
+    return ok;
+    }
+
+static void ReadMat(lua_State *L, int arg, mat_t m, size_t nr, size_t nc)
+    {
+    size_t i, j;
+    for(i = 0; i < nr; i++)
+        {
+        if(lua_rawgeti(L, arg, i+1) != LUA_TTABLE)
+            luaL_error(L, "malformed matrix");
+        for(j = 0; j < nc; j++)
+            {
+            lua_rawgeti(L, -1, j+1);
+            m[i][j] = luaL_checknumber(L, -1);
+            lua_pop(L, 1);
+            }
+        lua_pop(L, 1);
+        }
+    }
+
+static inline int ShapeUnm(lua_State *L, size_t nr, size_t nc)
+    {
+    size_t i, j;
+    mat_t m;
+    if(!SameShape(L, 1, 1)) return Unm(L);
+    ReadMat(L, 1, m, nr, nc);
+    for(i = 0; i < nr; i++)
+        for(j = 0; j < nc; j++)
+            m[i][j] = -m[i][j];
+    return pushmat(L, m, nr, nc, nr, nc);
+    }
+
+static inline int ShapeAdd(lua_State *L, size_t nr, size_t nc)
+    {
+    size_t i, j;
+    mat_t m, m1;
+    if(!SameShape(L, 1, 1) || !SameShape(L, 2, 1)) return Add(L);
+    ReadMat(L, 1, m, nr, nc);
+    ReadMat(L, 2, m1, nr, nc);
+    for(i = 0; i < nr; i++)
+        for(j = 0; j < nc; j++)
+            m[i][j] += m1[i][j];
+    return pushmat(L, m, nr, nc, nr, nc);
+    }
+
+static inline int ShapeSub(lua_State *L, size_t nr, size_t nc)
+    {
+    size_t i, j;
+    mat_t m, m1;
+    if(!SameShape(L, 1, 1) || !SameShape(L, 2, 1)) return Sub(L);
+    ReadMat(L, 1, m, nr, nc);
+    ReadMat(L, 2, m1, nr, nc);
+    for(i = 0; i < nr; i++)
+        for(j = 0; j < nc; j++)
+            m[i][j] -= m1[i][j];
+    return pushmat(L, m, nr, nc, nr, nc);
+    }
+
+static inline int ShapeMul(lua_State *L, size_t nr, size_t nc)
+/* mat * scalar, scalar * mat, mat * column vector, and (square) mat * mat of the same shape */
+    {
+    size_t i, j, k;
+    mat_t m, m1, m2;
+    vec_t v, v1;
+    double s;
+    int sarg = 0, marg = 1;
+    if(lua_type(L, 1) == LUA_TNUMBER) { sarg = 1; marg = 2; }
+    else if(lua_type(L, 2) == LUA_TNUMBER) sarg = 2;
+    if(!SameShape(L, marg, 1)) return Mul(L);
+    if(sarg)
+        {
+        ReadMat(L, marg, m, nr, nc);
+        s = lua_tonumber(L, sarg);
+        for(i = 0; i < nr; i++)
+            for(j = 0; j < nc; j++)
+                m[i][j] *= s;
+        return pushmat(L, m, nr, nc, nr, nc);
+        }
+    if(SameShape(L, 2, 2)) /* MxN * Nx1 */
+        {
+        ReadMat(L, 1, m, nr, nc);
+        for(i = 0; i < nc; i++)
+            {
+            lua_rawgeti(L, 2, i+1);
+            v[i] = luaL_checknumber(L, -1);
+            lua_pop(L, 1);
+            }
+        for(i = 0; i < nr; i++)
+            {
+            s = 0;
+            for(j = 0; j < nc; j++)
+                s += (m[i][j] * v[j]);
+            v1[i] = s;
+            }
+        return pushvec(L, v1, nr, nr, 0);
+        }
+    if(nr != nc || !SameShape(L, 2, 1)) return Mul(L);
+    ReadMat(L, 1, m1, nr, nc);
+    ReadMat(L, 2, m2, nr, nc);
+    if(nr == 4 && mat_isaffine(m1) && mat_isaffine(m2))
+        mat_affine_mul(m, m1, m2);
+    else
+        {
+        for(i = 0; i < nr; i++)
+            for(j = 0; j < nc; j++)
+                {
+                s = 0;
+                for(k = 0; k < nc; k++)
+                    s += m1[i][k] * m2[k][j];
+                m[i][j] = s;
+                }
+        }
+    return pushmat(L, m, nr, nc, nr, nc);
+    }
+
+static inline int ShapeDiv(lua_State *L, size_t nr, size_t nc)
+    {
+    size_t i, j;
+    mat_t m;
+    double s;
+    if(!SameShape(L, 1, 1) || lua_type(L, 2) != LUA_TNUMBER) return Div(L);
+    ReadMat(L, 1, m, nr, nc);
+    s = lua_tonumber(L, 2);
+    for(i = 0; i < nr; i++)
+        for(j = 0; j < nc; j++)
+            m[i][j] /= s;
+    return pushmat(L, m, nr, nc, nr, nc);
+    }
+
+#define SHAPE_METAMETHODS(S, nr, nc)                                        \
+static int Unm##S(lua_State *L) { return ShapeUnm(L, nr, nc); }             \
+static int Add##S(lua_State *L) { return ShapeAdd(L, nr, nc); }             \
+static int Sub##S(lua_State *L) { return ShapeSub(L, nr, nc); }             \
+static int Mul##S(lua_State *L) { return ShapeMul(L, nr, nc); }             \
+static int Div##S(lua_State *L) { return ShapeDiv(L, nr, nc); }             \
+static const struct luaL_Reg Metamethods##S[] =                             \
+    {                                                                       \
+        { "__unm", Unm##S },                                                \
+        { "__add", Add##S },                                                \
+        { "__sub", Sub##S },                                                \
+        { "__mul", Mul##S },                                                \
+        { "__div", Div##S },                                                \
+        { NULL, NULL } /* sentinel */                                       \
+    };
+
+SHAPE_METAMETHODS(2, 2, 2)
+SHAPE_METAMETHODS(3, 3, 3)
+SHAPE_METAMETHODS(4, 4, 4)
+SHAPE_METAMETHODS(2x3, 2, 3)
+SHAPE_METAMETHODS(3x2, 3, 2)
+SHAPE_METAMETHODS(2x4, 2, 4)
+SHAPE_METAMETHODS(4x2, 4, 2)
+SHAPE_METAMETHODS(3x4, 3, 4)
+SHAPE_METAMETHODS(4x3, 4, 3)
+
+static void NewShape(lua_State *L, const char *name, size_t nr, size_t nc, const char *vecname,
+            const struct luaL_Reg *metamethods)
+    {
+    newshapemetatable(L, MAT_MT, name, &ShapeKey[nr][nc]);
+    lua_pushvalue(L, -1);
+    luaL_getmetatable(L, vecname);
+    luaL_setfuncs(L, metamethods, 2);
+    lua_pop(L, 1);
+    }
+
 static int Pow(lua_State *L)
     {
     size_t nr, nc;
@@ -747,6 +1036,50 @@ int mat_Inv(lua_State *L)
     return pushmat(L, inv, nr, nr, nr, nr);
     }
 
+static int CheckMat4(lua_State *L, int arg, mat_t m)
+    {
+    size_t nr, nc;
+    checkmat(L, arg, m, &nr, &nc);
+    if((nr != 4) || (nc != 4))
+        return luaL_argerror(L, arg, "expected 4x4 matrix");
+    return 1;
+    }
+
+int mat_IsAffine(lua_State *L)
+    {
+    size_t nr, nc;
+    mat_t m;
+    checkmat(L, 1, m, &nr, &nc);
+    lua_pushboolean(L, (nr == 4) && (nc == 4) && mat_isaffine(m));
+    return 1;
+    }
+
+int mat_AffineInv(lua_State *L)
+    {
+    mat_t m, inv;
+    CheckMat4(L, 1, m);
+    if(!mat_affine_inv(inv, m))
+        return luaL_argerror(L, 1, "singular matrix");
+    return pushmat(L, inv, 4, 4, 4, 4);
+    }
+
+int mat_RigidInv(lua_State *L)
+    {
+    mat_t m, inv;
+    CheckMat4(L, 1, m);
+    mat_rigid_inv(inv, m);
+    return pushmat(L, inv, 4, 4, 4, 4);
+    }
+
+int mat_AffineMul(lua_State *L)
+    {
+    mat_t m1, m2, m;
+    CheckMat4(L, 1, m1);
+    CheckMat4(L, 2, m2);
+    mat_affine_mul(m, m1, m2);
+    return pushmat(L, m, 4, 4, 4, 4);
+    }
+
 
 int mat_Trace(lua_State *L)
     {
@@ -932,6 +1265,147 @@ int mat_Fade(lua_State *L)
     }
 
 
+/*------------------------------------------------------------------------------*
+ | Chained products                                                             |
+ *------------------------------------------------------------------------------*/
+
+/* Operand of a chained product. Vectors are stored as Nx1 (column) or 1xN (row)
+ * matrices, numbers as 1x1 matrices.
+ */
+#define OP_NUM  0
+#define OP_MAT  1
+#define OP_COL  2
+#define OP_ROW  3
+typedef struct { int kind; size_t nr, nc; mat_t m; } operand_t;
+
+static void CheckOperand(lua_State *L, int arg, operand_t *op)
+    {
+    vec_t v;
+    size_t i, size;
+    unsigned int isrow;
+    if(lua_type(L, arg) == LUA_TNUMBER)
+        {
+        op->kind = OP_NUM;
+        op->nr = op->nc = 1;
+        op->m[0][0] = lua_tonumber(L, arg);
+        return;
+        }
+    if(testvec(L, arg, v, &size, &isrow))
+        {
+        op->kind = isrow ? OP_ROW : OP_COL;
+        op->nr = isrow ? 1 : size;
+        op->nc = isrow ? size : 1;
+        for(i = 0; i < size; i++)
+            { if(isrow) op->m[0][i] = v[i]; else op->m[i][0] = v[i]; }
+        return;
+        }
+    op->kind = OP_MAT;
+    checkmat(L, arg, op->m, &op->nr, &op->nc);
+    }
+
+static int OperandMul(operand_t *dst, operand_t *a, operand_t *b)
+/* dst = a * b (dst may be a or b). Returns 0 if the operands are not compatible */
+    {
+    size_t i, j, k;
+    double s;
+    mat_t m;
+    if(a->kind == OP_NUM || b->kind == OP_NUM)
+        {
+        operand_t *x = (a->kind == OP_NUM) ? b : a;
+        s = (a->kind == OP_NUM) ? a->m[0][0] : b->m[0][0];
+        for(i = 0; i < x->nr; i++)
+            for(j = 0; j < x->nc; j++)
+                m[i][j] = x->m[i][j] * s;
+        dst->kind = x->kind; dst->nr = x->nr; dst->nc = x->nc;
+        mat_copy(dst->m, m);
+        return 1;
+        }
+    if((a->kind == OP_COL && b->kind == OP_COL) || (a->kind == OP_ROW && b->kind == OP_ROW))
+        { /* dot product, as in the '*' operator for vectors */
+        if(a->nr != b->nr || a->nc != b->nc) return 0;
+        s = 0;
+        for(i = 0; i < a->nr; i++)
+            for(j = 0; j < a->nc; j++)
+                s += a->m[i][j] * b->m[i][j];
+        dst->kind = OP_NUM; dst->nr = dst->nc = 1;
+        dst->m[0][0] = s;
+        return 1;
+        }
+    if(a->nc != b->nr) return 0;
+    if((a->kind == OP_MAT && b->kind == OP_ROW) || (a->kind == OP_COL && b->kind == OP_MAT))
+        return 0;
+    for(i = 0; i < a->nr; i++)
+        for(j = 0; j < b->nc; j++)
+            {
+            s = 0;
+            for(k = 0; k < a->nc; k++)
+                s += a->m[i][k] * b->m[k][j];
+            m[i][j] = s;
+            }
+    if(a->kind == OP_ROW)
+        dst->kind = (b->kind == OP_COL) ? OP_NUM : OP_ROW;
+    else if(b->kind == OP_COL)
+        dst->kind = OP_COL;
+    else
+        dst->kind = OP_MAT; /* mat*mat, col*row */
+    dst->nr = a->nr; dst->nc = b->nc;
+    mat_copy(dst->m, m);
+    return 1;
+    }
+
+static int ChainMul(lua_State *L)
+/* x = mul(x1, x2, ..., xN) 
+ * Same as x1 * x2 * ... * xN, but evaluated in a single call with no intermediate
+ * Lua objects. If the last operand is a column vector and the others are matrices
+ * or numbers, the chain is evaluated from right to left (matrix-vector products only).
+ */
+    {
+    operand_t acc, op;
+    int i, n = lua_gettop(L);
+    int rtl = 1;
+    vec_t v;
+    if(n < 2)
+        return luaL_argerror(L, 2, "missing operand");
+    CheckOperand(L, n, &acc);
+    if(acc.kind != OP_COL) rtl = 0;
+    for(i = 1; rtl && i < n; i++)
+        if(testvec(L, i, NULL, NULL, NULL)) rtl = 0;
+    if(rtl)
+        {
+        for(i = n-1; i >= 1; i--)
+            {
+            CheckOperand(L, i, &op);
+            if(!OperandMul(&acc, &op, &acc))
+                return luaL_error(L, OPERANDS_ERROR);
+            }
+        }
+    else
+        {
+        CheckOperand(L, 1, &acc);
+        for(i = 2; i <= n; i++)
+            {
+            CheckOperand(L, i, &op);
+            if(!OperandMul(&acc, &acc, &op))
+                return luaL_error(L, OPERANDS_ERROR);
+            }
+        }
+    switch(acc.kind)
+        {
+        case OP_NUM: lua_pushnumber(L, acc.m[0][0]); return 1;
+        case OP_MAT: return pushmat(L, acc.m, acc.nr, acc.nc, acc.nr, acc.nc);
+        case OP_COL: for(i = 0; i < (int)acc.nr; i++) v[i] = acc.m[i][0];
+                     return pushvec(L, v, acc.nr, acc.nr, 0);
+        case OP_ROW: for(i = 0; i < (int)acc.nc; i++) v[i] = acc.m[0][i];
+                     return pushvec(L, v, acc.nc, acc.nc, 1);
+        }
+    return 0;
+    }
+
+#undef OP_NUM
+#undef OP_MAT
+#undef OP_COL
+#undef OP_ROW
+
 static const struct luaL_Reg Metamethods[] = 
     {
         { "__tostring", ToString },
@@ -951,6 +1425,10 @@ static const struct luaL_Reg Methods[] =
         { "adj", mat_Adj },
         { "det", mat_Det },
         { "inv", mat_Inv },
+        { "affine_inv", mat_AffineInv },
+        { "rigid_inv", mat_RigidInv },
+        { "affine_mul", mat_AffineMul },
+        { "isaffine", mat_IsAffine },
         { "transpose", mat_Transpose },
         { "trace", mat_Trace },
         { "quat", mat_Quat },
@@ -989,13 +1467,24 @@ static const struct luaL_Reg Functions[] =
         { "ismat4x2", IsMat4x2 },
         { "ismat3x4", IsMat3x4 },
         { "ismat4x3", IsMat4x3 },
+        { "mul", ChainMul },
         { NULL, NULL } /* sentinel */
     };
 
 void moonglmath_open_mat(lua_State *L)
     {
     newmetatable(L, MAT_MT);
+    settypetag(L, MAT_MT, TAG_MAT);
     metatable_setfuncs(L, MAT_MT, Metamethods, Methods);
+    NewShape(L, "moonglmath_mat2", 2, 2, "moonglmath_vec2", Metamethods2);
+    NewShape(L, "moonglmath_mat3", 3, 3, "moonglmath_vec3", Metamethods3);
+    NewShape(L, "moonglmath_mat4", 4, 4, "moonglmath_vec4", Metamethods4);
+    NewShape(L, "moonglmath_mat2x3", 2, 3, "moonglmath_vec3", Metamethods2x3);
+    NewShape(L, "moonglmath_mat3x2", 3, 2, "moonglmath_vec2", Metamethods3x2);
+    NewShape(L, "moonglmath_mat2x4", 2, 4, "moonglmath_vec4", Metamethods2x4);
+    NewShape(L, "moonglmath_mat4x2", 4, 2, "moonglmath_vec2", Metamethods4x2);
+    NewShape(L, "moonglmath_mat3x4", 3, 4, "moonglmath_vec4", Metamethods3x4);
+    NewShape(L, "moonglmath_mat4x3", 4, 3, "moonglmath_vec3", Metamethods4x3);
     luaL_setfuncs(L, Functions, 0);
     }
 
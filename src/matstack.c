@@ -0,0 +1,324 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Stefano Trettel
+ *
+ * Software repository: MoonGLMATH, https://github.com/stetre/moonglmath
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "internal.h"
+
+/* Matrix stack.
+ *
+ * A stack of 4x4 matrices kept in C memory, in the style of the legacy OpenGL matrix stack.
+ * All the operations act on the top matrix (post-multiplying it, i.e. top = top * m), and
+ * a Lua matrix is created only when explicitly requested with top(), while write() copies
+ * the top matrix directly into a hostmem.
+ * The stack always has at least one level, and grows as needed on push().
+ */
+
+struct moonglmath_matstack_s {
+    uint32_t depth, cap; /* no. of levels, allocated levels */
+    mat_t *m; /* m[depth-1] is the top matrix */
+};
+
+static void Identity(mat_t m)
+    {
+    mat_clear(m);
+    m[0][0] = m[1][1] = m[2][2] = m[3][3] = 1;
+    }
+
+static void MulBy(mat_t top, mat_t m)
+/* top = top * m */
+    {
+    mat_t tmp;
+    if(mat_isaffine(top) && mat_isaffine(m))
+        {
+        mat_affine_mul(tmp, top, m);
+        mat_copy(top, tmp);
+        }
+    else
+        mat_mulby(top, m, 4, 4, 4);
+    }
+
+static void TranslateBy(mat_t top, double x, double y, double z)
+/* top = top * translate(x, y, z), i.e. only the last column changes */
+    {
+    int i;
+    for(i = 0; i < 4; i++)
+        top[i][3] += top[i][0]*x + top[i][1]*y + top[i][2]*z;
+    }
+
+static void ScaleBy(mat_t top, double x, double y, double z)
+/* top = top * scale(x, y, z), i.e. the first three columns are scaled */
+    {
+    int i;
+    for(i = 0; i < 4; i++)
+        {
+        top[i][0] *= x;
+        top[i][1] *= y;
+        top[i][2] *= z;
+        }
+    }
+
+/*------------------------------------------------------------------------------*
+ | Lua functions                                                                |
+ *------------------------------------------------------------------------------*/
+
+static int freematstack(lua_State *L, ud_t *ud)
+    {
+    matstack_t *s = (matstack_t*)ud->handle;
+    if(!freeuserdata(L, ud, "matstack")) return 0;
+    Free(L, s->m);
+    Free(L, s);
+    return 0;
+    }
+
+#define Top(s) ((s)->m[(s)->depth - 1])
+
+static int Create(lua_State *L)
+/* matstack([capacity]) */
+    {
+    ud_t *ud;
+    matstack_t *s;
+    lua_Integer cap = luaL_optinteger(L, 1, 32);
+    if(cap < 1) return luaL_argerror(L, 1, errstring(ERR_VALUE));
+    s = (matstack_t*)Malloc(L, sizeof(matstack_t));
+    ud = newuserdata(L, s, MATSTACK_MT, "matstack");
+    ud->destructor = freematstack;
+    s->cap = (uint32_t)cap;
+    s->m = (mat_t*)Malloc(L, s->cap * sizeof(mat_t));
+    s->depth = 1;
+    Identity(Top(s));
+    return 1;
+    }
+
+static int Push(lua_State *L)
+/* push(): duplicates the top matrix */
+    {
+    matstack_t *s = checkmatstack(L, 1, NULL);
+    if(s->depth == s->cap)
+        {
+        s->m = (mat_t*)Realloc(L, s->m, s->cap * sizeof(mat_t), 2 * s->cap * sizeof(mat_t));
+        s->cap *= 2;
+        }
+    mat_copy(s->m[s->depth], Top(s));
+    s->depth++;
+    return 0;
+    }
+
+static int Pop(lua_State *L)
+    {
+    matstack_t *s = checkmatstack(L, 1, NULL);
+    if(s->depth == 1)
+        return luaL_error(L, "matrix stack underflow");
+    s->depth--;
+    return 0;
+    }
+
+static int Depth(lua_State *L)
+    {
+    matstack_t *s = checkmatstack(L, 1, NULL);
+    lua_pushinteger(L, s->depth);
+    return 1;
+    }
+
+static int Reset(lua_State *L)
+/* reset(): pops all the levels but the first, and loads the identity */
+    {
+    matstack_t *s = checkmatstack(L, 1, NULL);
+    s->depth = 1;
+    Identity(Top(s));
+    return 0;
+    }
+
+static int LoadIdentity(lua_State *L)
+    {
+    matstack_t *s = checkmatstack(L, 1, NULL);
+    Identity(Top(s));
+    return 0;
+    }
+
+static int Load(lua_State *L)
+/* load(mat4) */
+    {
+    mat_t m;
+    size_t nr, nc;
+    matstack_t *s = checkmatstack(L, 1, NULL);
+    checkmat(L, 2, m, &nr, &nc);
+    if(nr != 4 || nc != 4)
+        return luaL_argerror(L, 2, "mat4 expected");
+    mat_copy(Top(s), m);
+    return 0;
+    }
+
+static int Mul(lua_State *L)
+/* mul(mat4) */
+    {
+    mat_t m;
+    size_t nr, nc;
+    matstack_t *s = checkmatstack(L, 1, NULL);
+    checkmat(L, 2, m, &nr, &nc);
+    if(nr != 4 || nc != 4)
+        return luaL_argerror(L, 2, "mat4 expected");
+    MulBy(Top(s), m);
+    return 0;
+    }
+
+static int Translate(lua_State *L)
+/* translate(x, y, z) | translate(vec3) */
+    {
+    vec_t v;
+    matstack_t *s = checkmatstack(L, 1, NULL);
+    if(!testvec(L, 2, v, NULL, NULL)) 
+        {
+        v[0] = luaL_checknumber(L, 2);
+        v[1] = luaL_checknumber(L, 3);
+        v[2] = luaL_checknumber(L, 4);
+        }
+    TranslateBy(Top(s), v[0], v[1], v[2]);
+    return 0;
+    }
+
+static int Scale(lua_State *L)
+/* scale(x, [y, z]) | scale(vec3) */
+    {
+    vec_t v;
+    matstack_t *s = checkmatstack(L, 1, NULL);
+    if(!testvec(L, 2, v, NULL, NULL)) 
+        {
+        v[0] = luaL_checknumber(L, 2);
+        if(lua_isnoneornil(L, 3) && lua_isnoneornil(L, 4))
+            v[1] = v[2] = v[0];
+        else
+            {
+            v[1] = luaL_checknumber(L, 3);
+            v[2] = luaL_checknumber(L, 4);
+            }
+        }
+    ScaleBy(Top(s), v[0], v[1], v[2]);
+    return 0;
+    }
+
+static int Rotate(lua_State *L)
+/* rotate(rad, x, y, z) | rotate(rad, vec3), as glmath.rotate() */
+    {
+    vec_t v;
+    mat_t m;
+    matstack_t *s = checkmatstack(L, 1, NULL);
+    double rad = luaL_checknumber(L, 2);
+    if(!testvec(L, 3, v, NULL, NULL)) 
+        {
+        v[0] = luaL_checknumber(L, 3);
+        v[1] = luaL_checknumber(L, 4);
+        v[2] = luaL_checknumber(L, 5);
+        }
+    rotate(m, v[0], v[1], v[2], rad);
+    MulBy(Top(s), m);
+    return 0;
+    }
+
+#define ROTATE_FUNC(Func, func)                 \
+static int Func(lua_State *L)                   \
+    {                                           \
+    mat_t m;                                    \
+    matstack_t *s = checkmatstack(L, 1, NULL);  \
+    func(m, luaL_checknumber(L, 2));            \
+    MulBy(Top(s), m);                           \
+    return 0;                                   \
+    }
+ROTATE_FUNC(RotateX, rotate_x)
+ROTATE_FUNC(RotateY, rotate_y)
+ROTATE_FUNC(RotateZ, rotate_z)
+#undef ROTATE_FUNC
+
+static int TopMat(lua_State *L)
+/* mat4 = top() */
+    {
+    matstack_t *s = checkmatstack(L, 1, NULL);
+    return pushmat(L, Top(s), 4, 4, 4, 4);
+    }
+
+static int Write(lua_State *L)
+/* write(hostmem, [index=1], [type]) 
+ * Writes the top matrix in row-major order as the index-th element of the packed array
+ * of 4x4 matrices contained in hostmem.
+ */
+    {
+    int r, c;
+    char *p;
+    size_t count;
+    matstack_t *s = checkmatstack(L, 1, NULL);
+    lua_Integer index = luaL_optinteger(L, 3, 1);
+    int type = checkrealtype(L, 4);
+    if(index < 1) return luaL_argerror(L, 3, errstring(ERR_VALUE));
+    count = (size_t)index;
+    p = checkhostmemarray(L, 2, 0, 16 * sizeoftype(type), &count);
+    for(r = 0; r < 4; r++)
+        for(c = 0; c < 4; c++)
+            setreal(p, type, 16*(index-1) + 4*r + c, Top(s)[r][c]);
+    return 0;
+    }
+
+RAW_FUNC(matstack)
+TYPE_FUNC(matstack)
+DELETE_FUNC(matstack)
+
+static const struct luaL_Reg Methods[] = 
+    {
+        { "raw", Raw },
+        { "type", Type },
+        { "free", Delete },
+        { "push", Push },
+        { "pop", Pop },
+        { "depth", Depth },
+        { "reset", Reset },
+        { "load_identity", LoadIdentity },
+        { "load", Load },
+        { "mul", Mul },
+        { "translate", Translate },
+        { "scale", Scale },
+        { "rotate", Rotate },
+        { "rotate_x", RotateX },
+        { "rotate_y", RotateY },
+        { "rotate_z", RotateZ },
+        { "top", TopMat },
+        { "write", Write },
+        { NULL, NULL } /* sentinel */
+    };
+
+static const struct luaL_Reg MetaMethods[] = 
+    {
+        { "__gc",  Delete },
+        { NULL, NULL } /* sentinel */
+    };
+
+static const struct luaL_Reg Functions[] = 
+    {
+        { "matstack", Create },
+        { NULL, NULL } /* sentinel */
+    };
+
+void moonglmath_open_matstack(lua_State *L)
+    {
+    udata_define(L, MATSTACK_MT, Methods, MetaMethods);
+    luaL_setfuncs(L, Functions, 0);
+    }
+
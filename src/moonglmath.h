@@ -49,6 +49,7 @@ typedef double moonglmath_rect_t[4];
 typedef double moonglmath_mat_t[4][4];
 typedef double moonglmath_quat_t[4];
 typedef double complex moonglmath_complex_t;
+typedef double moonglmath_dualquat_t[8];
 
 /* Metatables names (keys in the Lua registry) */
 #define MOONGLMATH_VEC_MT "moonglmath_vec"
@@ -57,6 +58,7 @@ typedef double complex moonglmath_complex_t;
 #define MOONGLMATH_MAT_MT "moonglmath_mat"
 #define MOONGLMATH_QUAT_MT "moonglmath_quat"
 #define MOONGLMATH_COMPLEX_MT "moonglmath_complex"
+#define MOONGLMATH_DUALQUAT_MT "moonglmath_dualquat"
 
 int moonglmath_testmetatable(lua_State *L, int arg, const char *metatable);
 int moonglmath_checkmetatable(lua_State *L, int arg, const char *metatable);
@@ -67,6 +69,7 @@ int moonglmath_checkmetatable(lua_State *L, int arg, const char *metatable);
 #define moonglmath_ismat(L, arg) moonglmath_testmetatable((L), arg, MOONGLMATH_MAT_MT)
 #define moonglmath_isquat(L, arg) moonglmath_testmetatable((L), arg, MOONGLMATH_QUAT_MT)
 #define moonglmath_iscomplex(L, arg) moonglmath_testmetatable((L), arg, MOONGLMATH_COMPLEX_MT)
+#define moonglmath_isdualquat(L, arg) moonglmath_testmetatable((L), arg, MOONGLMATH_DUALQUAT_MT)
 
 int moonglmath_testvec(lua_State *L, int arg, moonglmath_vec_t v, size_t *size, unsigned int *isrow);
 int moonglmath_checkvec(lua_State *L, int arg, moonglmath_vec_t v, size_t *size, unsigned int *isrow);
@@ -92,6 +95,10 @@ int moonglmath_testcomplex(lua_State *L, int arg, moonglmath_complex_t *z);
 int moonglmath_checkcomplex(lua_State *L, int arg, moonglmath_complex_t *z);
 int moonglmath_pushcomplex(lua_State *L, moonglmath_complex_t z);
 
+int moonglmath_testdualquat(lua_State *L, int arg, moonglmath_dualquat_t dq);
+int moonglmath_checkdualquat(lua_State *L, int arg, moonglmath_dualquat_t dq);
+int moonglmath_pushdualquat(lua_State *L, moonglmath_dualquat_t dq);
+
 /*---------------------------------------------------------------------------*
  | Vector                                                                    |
  *---------------------------------------------------------------------------*/
@@ -104,6 +111,7 @@ void moonglmath_vec_sub(moonglmath_vec_t dst, moonglmath_vec_t v1, moonglmath_ve
 double moonglmath_vec_norm(moonglmath_vec_t v, size_t n);
 double moonglmath_vec_norm2(moonglmath_vec_t v, size_t n);
 void moonglmath_vec_normalize(moonglmath_vec_t v, size_t n);
+void moonglmath_vec_fast_normalize(moonglmath_vec_t v, size_t n);
 void moonglmath_vec_div(moonglmath_vec_t dst, moonglmath_vec_t v, double s, size_t n);
 double moonglmath_vec_dot(moonglmath_vec_t v1, moonglmath_vec_t v2, size_t n);
 void moonglmath_vec_vxs(moonglmath_vec_t dst, moonglmath_vec_t v, double s, size_t n);
@@ -150,6 +158,10 @@ double moonglmath_mat_det3(moonglmath_mat_t m);
 double moonglmath_mat_det4(moonglmath_mat_t m);
 void moonglmath_mat_adj(moonglmath_mat_t dst, moonglmath_mat_t m, size_t n);
 int moonglmath_mat_inv(moonglmath_mat_t dst, moonglmath_mat_t m, size_t n);
+int moonglmath_mat_isaffine(moonglmath_mat_t m);
+int moonglmath_mat_affine_inv(moonglmath_mat_t dst, moonglmath_mat_t m);
+void moonglmath_mat_rigid_inv(moonglmath_mat_t dst, moonglmath_mat_t m);
+void moonglmath_mat_affine_mul(moonglmath_mat_t dst, moonglmath_mat_t m1, moonglmath_mat_t m2);
 int moonglmath_mat_clamp(moonglmath_mat_t dst, moonglmath_mat_t m, moonglmath_mat_t minm, moonglmath_mat_t maxm, size_t nr, size_t nc);
 int moonglmath_mat_mix(moonglmath_mat_t dst, moonglmath_mat_t m1, moonglmath_mat_t m2, size_t nr, size_t nc, double k);
 int moonglmath_mat_step(moonglmath_mat_t dst, moonglmath_mat_t m, moonglmath_mat_t edge, size_t nr, size_t nc);
@@ -168,6 +180,7 @@ void moonglmath_quat_sub(moonglmath_quat_t dst, moonglmath_quat_t q1, moonglmath
 double moonglmath_quat_norm(moonglmath_quat_t q);
 double moonglmath_quat_norm2(moonglmath_quat_t q);
 void moonglmath_quat_normalize(moonglmath_quat_t q);
+void moonglmath_quat_fast_normalize(moonglmath_quat_t q);
 void moonglmath_quat_conj(moonglmath_quat_t dst, moonglmath_quat_t q); 
 void moonglmath_quat_inv(moonglmath_quat_t dst, moonglmath_quat_t q);
 void moonglmath_quat_div(moonglmath_quat_t dst, moonglmath_quat_t q, double s);
@@ -175,6 +188,23 @@ void moonglmath_quat_mul(moonglmath_quat_t dst, moonglmath_quat_t q, moonglmath_
 void moonglmath_quat_qxs(moonglmath_quat_t dst, moonglmath_quat_t q, double s);
 void moonglmath_quat_mix(moonglmath_quat_t dst, moonglmath_quat_t q, moonglmath_quat_t p, double t);
 void moonglmath_quat_slerp(moonglmath_quat_t dst, moonglmath_quat_t q, moonglmath_quat_t p, double t);
+void moonglmath_quat_nlerp(moonglmath_quat_t dst, moonglmath_quat_t q, moonglmath_quat_t p, double t);
+void moonglmath_quat_fast_slerp(moonglmath_quat_t dst, moonglmath_quat_t q, moonglmath_quat_t p, double t);
+void moonglmath_quat_frommat(moonglmath_quat_t q, moonglmath_mat_t m);
+
+/*---------------------------------------------------------------------------*
+ | Dual quaternion                                                           |
+ *---------------------------------------------------------------------------*/
+
+#define moonglmath_dualquat_clear(dq)   memset((dq), 0, sizeof(moonglmath_dualquat_t))
+#define moonglmath_dualquat_copy(dst, dq)   memcpy((dst), (dq), sizeof(moonglmath_dualquat_t))
+void moonglmath_dualquat_from_rt(moonglmath_dualquat_t dq, moonglmath_quat_t r, moonglmath_vec_t t);
+void moonglmath_dualquat_to_rt(moonglmath_quat_t r, moonglmath_vec_t t, moonglmath_dualquat_t dq);
+void moonglmath_dualquat_mul(moonglmath_dualquat_t dst, moonglmath_dualquat_t a, moonglmath_dualquat_t b);
+void moonglmath_dualquat_conj(moonglmath_dualquat_t dst, moonglmath_dualquat_t dq);
+void moonglmath_dualquat_normalize(moonglmath_dualquat_t dq);
+void moonglmath_dualquat_sclerp(moonglmath_dualquat_t dst, moonglmath_dualquat_t a, moonglmath_dualquat_t b, double t);
+void moonglmath_dualquat_transform(moonglmath_vec_t dst, moonglmath_dualquat_t dq, moonglmath_vec_t p);
 
 /*---------------------------------------------------------------------------*
  | Numbers                                                                   |
@@ -185,6 +215,7 @@ double moonglmath_mix(double x, double y, double k);
 double moonglmath_step(double x, double edge);
 double moonglmath_smoothstep(double x, double edge0, double edge1);
 double moonglmath_fade(double x, double edge0, double edge1);
+double moonglmath_fast_rsqrt(double x);
 
 /*---------------------------------------------------------------------------*
  | Other                                                                     |
@@ -196,9 +227,12 @@ double moonglmath_now(void);
 /* basic transforms */
 void moonglmath_translate(moonglmath_mat_t m, double x, double y, double z);
 void moonglmath_scale(moonglmath_mat_t m, double x, double y, double z);
+void moonglmath_rotate(moonglmath_mat_t m, double x, double y, double z, double rad);
 void moonglmath_rotate_x(moonglmath_mat_t m, double rad);
 void moonglmath_rotate_y(moonglmath_mat_t m, double rad);
 void moonglmath_rotate_z(moonglmath_mat_t m, double rad);
+void moonglmath_compose_trs(moonglmath_mat_t m, moonglmath_vec_t t, moonglmath_quat_t q, moonglmath_vec_t s);
+void moonglmath_decompose_trs(moonglmath_vec_t t, moonglmath_quat_t q, moonglmath_vec_t s, moonglmath_mat_t m);
 
 /* viewing */
 int moonglmath_look_at(moonglmath_mat_t dst, moonglmath_vec_t eye, moonglmath_vec_t at, moonglmath_vec_t up);
@@ -206,5 +240,109 @@ int moonglmath_ortho(moonglmath_mat_t dst, double l, double r, double b, double
 int moonglmath_frustum(moonglmath_mat_t dst, double l, double r, double b, double t, double n, double f);
 int moonglmath_perspective(moonglmath_mat_t dst, double fovy, double aspect, double n, double f);
 
+/*---------------------------------------------------------------------------*
+ | Hostmem                                                                   |
+ *---------------------------------------------------------------------------*/
+
+/* Pointer to the memory area of a hostmem and its size in bytes (test returns NULL if
+ * arg is not a hostmem, check raises an error). */
+void *moonglmath_testhostmemptr(lua_State *L, int arg, size_t *size);
+void *moonglmath_checkhostmemptr(lua_State *L, int arg, size_t *size);
+/* Pointer to a packed array of elements of elemsize bytes in the hostmem at arg, with
+ * the no. of elements taken from the optional integer at countarg (if countarg != 0),
+ * or passed in *count. Raises an error if the elements exceed the memory area. */
+char *moonglmath_checkhostmemarray(lua_State *L, int arg, int countarg, size_t elemsize, size_t *count);
+
+/*---------------------------------------------------------------------------*
+ | Batch operations (flat C ABI, see batch.c and moonglmath/ffi.lua)         |
+ *---------------------------------------------------------------------------*/
+
+void moonglmath_batch_mat4_mul(double *dst, const double *a, const double *b, size_t count);
+void moonglmath_batch_mat4_premul(double *dst, const double *m, const double *b, size_t count);
+void moonglmath_batch_mat4_transform(double *dst, const double *m, const double *src, size_t count);
+void moonglmath_batch_mat4_transform_points(double *dst, const double *m, const double *src, size_t count);
+void moonglmath_batch_mat4_transform_dirs(double *dst, const double *m, const double *src, size_t count);
+void moonglmath_batch_quat_mul(double *dst, const double *a, const double *b, size_t count);
+void moonglmath_batch_quat_rotate(double *dst, const double *q, const double *src, size_t count);
+void moonglmath_batch_vec3_normalize(double *dst, const double *src, size_t count);
+void moonglmath_batch_vec3_dot(double *dst, const double *a, const double *b, size_t count);
+void moonglmath_batch_vec3_cross(double *dst, const double *a, const double *b, size_t count);
+
+void moonglmath_batch_mat4_mulf(float *dst, const float *a, const float *b, size_t count);
+void moonglmath_batch_mat4_premulf(float *dst, const float *m, const float *b, size_t count);
+void moonglmath_batch_mat4_transformf(float *dst, const float *m, const float *src, size_t count);
+void moonglmath_batch_mat4_transform_pointsf(float *dst, const float *m, const float *src, size_t count);
+void moonglmath_batch_mat4_transform_dirsf(float *dst, const float *m, const float *src, size_t count);
+void moonglmath_batch_quat_mulf(float *dst, const float *a, const float *b, size_t count);
+void moonglmath_batch_quat_rotatef(float *dst, const float *q, const float *src, size_t count);
+void moonglmath_batch_vec3_normalizef(float *dst, const float *src, size_t count);
+void moonglmath_batch_vec3_dotf(float *dst, const float *a, const float *b, size_t count);
+void moonglmath_batch_vec3_crossf(float *dst, const float *a, const float *b, size_t count);
+
+/*---------------------------------------------------------------------------*
+ | Native API table                                                          |
+ *---------------------------------------------------------------------------*/
+
+/* When the moonglmath module is loaded, a pointer to a moonglmath_api_t table is stored
+ * (as a light userdata) in the Lua registry at MOONGLMATH_API_KEY, so that other C modules
+ * can use the functions below without linking to moonglmath:
+ *
+ *   const moonglmath_api_t *api = moonglmath_getapi(L);
+ *   if(!api) return luaL_error(L, "moonglmath not loaded");
+ *   p = api->checkhostmemptr(L, 1, &size);
+ *
+ * The table is only ever extended by appending new fields, and api->version is increased
+ * when this happens (so check it before using fields added after version 1).
+ */
+#define MOONGLMATH_API_KEY      "moonglmath_api"
+#define MOONGLMATH_API_VERSION  1
+
+typedef struct {
+    int version;
+    /* hostmem */
+    void *(*testhostmemptr)(lua_State *L, int arg, size_t *size);
+    void *(*checkhostmemptr)(lua_State *L, int arg, size_t *size);
+    char *(*checkhostmemarray)(lua_State *L, int arg, int countarg, size_t elemsize, size_t *count);
+    /* values */
+    int (*testvec)(lua_State *L, int arg, moonglmath_vec_t v, size_t *size, unsigned int *isrow);
+    int (*pushvec)(lua_State *L, moonglmath_vec_t v, size_t vsize, size_t size, unsigned int isrow);
+    int (*testmat)(lua_State *L, int arg, moonglmath_mat_t m, size_t *nr, size_t *nc);
+    int (*pushmat)(lua_State *L, moonglmath_mat_t m, size_t mr, size_t mc, size_t nr, size_t nc);
+    int (*testquat)(lua_State *L, int arg, moonglmath_quat_t q);
+    int (*pushquat)(lua_State *L, moonglmath_quat_t q);
+    /* batch operations (double) */
+    void (*batch_mat4_mul)(double *dst, const double *a, const double *b, size_t count);
+    void (*batch_mat4_premul)(double *dst, const double *m, const double *b, size_t count);
+    void (*batch_mat4_transform)(double *dst, const double *m, const double *src, size_t count);
+    void (*batch_mat4_transform_points)(double *dst, const double *m, const double *src, size_t count);
+    void (*batch_mat4_transform_dirs)(double *dst, const double *m, const double *src, size_t count);
+    void (*batch_quat_mul)(double *dst, const double *a, const double *b, size_t count);
+    void (*batch_quat_rotate)(double *dst, const double *q, const double *src, size_t count);
+    void (*batch_vec3_normalize)(double *dst, const double *src, size_t count);
+    void (*batch_vec3_dot)(double *dst, const double *a, const double *b, size_t count);
+    void (*batch_vec3_cross)(double *dst, const double *a, const double *b, size_t count);
+    /* batch operations (float) */
+    void (*batch_mat4_mulf)(float *dst, const float *a, const float *b, size_t count);
+    void (*batch_mat4_premulf)(float *dst, const float *m, const float *b, size_t count);
+    void (*batch_mat4_transformf)(float *dst, const float *m, const float *src, size_t count);
+    void (*batch_mat4_transform_pointsf)(float *dst, const float *m, const float *src, size_t count);
+    void (*batch_mat4_transform_dirsf)(float *dst, const float *m, const float *src, size_t count);
+    void (*batch_quat_mulf)(float *dst, const float *a, const float *b, size_t count);
+    void (*batch_quat_rotatef)(float *dst, const float *q, const float *src, size_t count);
+    void (*batch_vec3_normalizef)(float *dst, const float *src, size_t count);
+    void (*batch_vec3_dotf)(float *dst, const float *a, const float *b, size_t count);
+    void (*batch_vec3_crossf)(float *dst, const float *a, const float *b, size_t count);
+} moonglmath_api_t;
+
+static inline const moonglmath_api_t *moonglmath_getapi(lua_State *L)
+/* Returns the API table, or NULL if the moonglmath module is not loaded in L */
+    {
+    const moonglmath_api_t *api;
+    lua_getfield(L, LUA_REGISTRYINDEX, MOONGLMATH_API_KEY);
+    api = (const moonglmath_api_t*)lua_touserdata(L, -1);
+    lua_pop(L, 1);
+    return api;
+    }
+
 #endif /* moonglmathDEFINED */
 
@@ -41,6 +41,7 @@
 #define mat_t moonglmath_mat_t
 #define quat_t moonglmath_quat_t
 #define complex_t moonglmath_complex_t
+#define dualquat_t moonglmath_dualquat_t
 
 #define VEC_MT MOONGLMATH_VEC_MT
 #define BOX_MT MOONGLMATH_BOX_MT
@@ -48,6 +49,7 @@
 #define MAT_MT MOONGLMATH_MAT_MT
 #define QUAT_MT MOONGLMATH_QUAT_MT
 #define COMPLEX_MT MOONGLMATH_COMPLEX_MT
+#define DUALQUAT_MT MOONGLMATH_DUALQUAT_MT
 
 #define testmetatable moonglmath_testmetatable
 #define checkmetatable moonglmath_checkmetatable
@@ -82,6 +84,11 @@
 #define checkcomplex moonglmath_checkcomplex
 #define pushcomplex moonglmath_pushcomplex
 
+#define isdualquat moonglmath_isdualquat
+#define testdualquat moonglmath_testdualquat
+#define checkdualquat moonglmath_checkdualquat
+#define pushdualquat moonglmath_pushdualquat
+
 #define vec_clear moonglmath_vec_clear
 #define vec_copy moonglmath_vec_copy
 #define vec_unm moonglmath_vec_unm
@@ -90,6 +97,7 @@
 #define vec_norm moonglmath_vec_norm
 #define vec_norm2 moonglmath_vec_norm2
 #define vec_normalize moonglmath_vec_normalize
+#define vec_fast_normalize moonglmath_vec_fast_normalize
 #define vec_div moonglmath_vec_div
 #define vec_dot moonglmath_vec_dot
 #define vec_vxs moonglmath_vec_vxs
@@ -124,6 +132,10 @@
 #define mat_det4 moonglmath_mat_det4
 #define mat_adj moonglmath_mat_adj
 #define mat_inv moonglmath_mat_inv
+#define mat_isaffine moonglmath_mat_isaffine
+#define mat_affine_inv moonglmath_mat_affine_inv
+#define mat_rigid_inv moonglmath_mat_rigid_inv
+#define mat_affine_mul moonglmath_mat_affine_mul
 #define mat_clamp moonglmath_mat_clamp
 #define mat_mix moonglmath_mat_mix
 #define mat_step moonglmath_mat_step
@@ -138,6 +150,7 @@
 #define quat_norm moonglmath_quat_norm
 #define quat_norm2 moonglmath_quat_norm2
 #define quat_normalize moonglmath_quat_normalize
+#define quat_fast_normalize moonglmath_quat_fast_normalize
 #define quat_conj moonglmath_quat_conj
 #define quat_inv moonglmath_quat_inv
 #define quat_div moonglmath_quat_div
@@ -145,20 +158,37 @@
 #define quat_qxs moonglmath_quat_qxs
 #define quat_mix moonglmath_quat_mix
 #define quat_slerp moonglmath_quat_slerp
+#define quat_nlerp moonglmath_quat_nlerp
+#define quat_fast_slerp moonglmath_quat_fast_slerp
+#define quat_frommat moonglmath_quat_frommat
+
+#define dualquat_clear moonglmath_dualquat_clear
+#define dualquat_copy moonglmath_dualquat_copy
+#define dualquat_from_rt moonglmath_dualquat_from_rt
+#define dualquat_to_rt moonglmath_dualquat_to_rt
+#define dualquat_mul moonglmath_dualquat_mul
+#define dualquat_conj moonglmath_dualquat_conj
+#define dualquat_normalize moonglmath_dualquat_normalize
+#define dualquat_sclerp moonglmath_dualquat_sclerp
+#define dualquat_transform moonglmath_dualquat_transform
 
 #define clamp moonglmath_clamp
 #define mix moonglmath_mix
 #define step moonglmath_step
 #define smoothstep moonglmath_smoothstep
 #define fade moonglmath_fade
+#define fast_rsqrt moonglmath_fast_rsqrt
 
 #define now moonglmath_now
 
 #define translate moonglmath_translate
 #define scale moonglmath_scale
+#define rotate moonglmath_rotate
 #define rotate_x moonglmath_rotate_x
 #define rotate_y moonglmath_rotate_y
 #define rotate_z moonglmath_rotate_z
+#define compose_trs moonglmath_compose_trs
+#define decompose_trs moonglmath_decompose_trs
 
 
 #define look_at moonglmath_look_at
@@ -102,3 +102,30 @@ int num_Fade(lua_State *L)
     return 1;
     }
 
+double fast_rsqrt(double x)
+/* Approximate 1/sqrt(x), for x > 0.
+ * Initial guess with the well-known bit trick on the float representation,
+ * refined with two Newton-Raphson iterations (max relative error < 5e-6).
+ * The guess is useless if x is not a normal float (it overflows to inf or is subnormal),
+ * so outside FLT_MIN..FLT_MAX (and for x <= 0 or NaN) it falls back to 1/sqrt(x).
+ */
+    {
+    union { float f; uint32_t i; } u;
+    double y;
+    if(!(x >= FLT_MIN && x <= FLT_MAX))
+        return 1.0/sqrt(x);
+    u.f = (float)x;
+    u.i = 0x5f375a86 - (u.i >> 1);
+    y = u.f;
+    y = y*(1.5 - 0.5*x*y*y);
+    y = y*(1.5 - 0.5*x*y*y);
+    return y;
+    }
+
+int num_FastRsqrt(lua_State *L)
+    {
+    double x = luaL_checknumber(L, 1);
+    lua_pushnumber(L, fast_rsqrt(x));
+    return 1;
+    }
+
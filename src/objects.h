@@ -39,6 +39,12 @@ typedef struct {
 
 /* Objects' metatable names */
 #define HOSTMEM_MT "moonglmath_hostmem"
+#define GRID_MT "moonglmath_grid"
+#define HIERARCHY_MT "moonglmath_hierarchy"
+#define KERNEL_MT "moonglmath_kernel"
+#define LAYOUT_MT "moonglmath_layout"
+#define MATSTACK_MT "moonglmath_matstack"
+#define CAMERA_MT "moonglmath_camera"
 
 /* Userdata memory associated with objects */
 #define ud_t moonglmath_ud_t
@@ -99,9 +105,67 @@ int freechildren(lua_State *L,  const char *mt, ud_t *parent_ud);
 #define testhostmem(L, arg, udp) (hostmem_t*)testxxx((L), (arg), (udp), HOSTMEM_MT)
 #define pushhostmem(L, handle) pushxxx((L), (handle))
 #define checkhostmemlist(L, arg, count, err) (hostmem_t*)checkxxxlist((L), (arg), (count), (err), HOSTMEM_MT)
+#define checkhostmemarray moonglmath_checkhostmemarray /* declared in moonglmath.h */
+
+/* grid.c */
+#define grid_t moonglmath_grid_t
+typedef struct moonglmath_grid_s grid_t;
+#define checkgrid(L, arg, udp) (grid_t*)checkxxx((L), (arg), (udp), GRID_MT)
+#define testgrid(L, arg, udp) (grid_t*)testxxx((L), (arg), (udp), GRID_MT)
+#define pushgrid(L, handle) pushxxx((L), (handle))
+
+/* hierarchy.c */
+#define hierarchy_t moonglmath_hierarchy_t
+typedef struct moonglmath_hierarchy_s hierarchy_t;
+#define checkhierarchy(L, arg, udp) (hierarchy_t*)checkxxx((L), (arg), (udp), HIERARCHY_MT)
+#define testhierarchy(L, arg, udp) (hierarchy_t*)testxxx((L), (arg), (udp), HIERARCHY_MT)
+#define pushhierarchy(L, handle) pushxxx((L), (handle))
+
+/* kernel.c */
+#define kernel_t moonglmath_kernel_t
+typedef struct moonglmath_kernel_s kernel_t;
+#define checkkernel(L, arg, udp) (kernel_t*)checkxxx((L), (arg), (udp), KERNEL_MT)
+#define testkernel(L, arg, udp) (kernel_t*)testxxx((L), (arg), (udp), KERNEL_MT)
+#define pushkernel(L, handle) pushxxx((L), (handle))
+
+/* layout.c */
+#define layout_t moonglmath_layout_t
+typedef struct moonglmath_layout_s layout_t;
+#define checklayout(L, arg, udp) (layout_t*)checkxxx((L), (arg), (udp), LAYOUT_MT)
+#define testlayout(L, arg, udp) (layout_t*)testxxx((L), (arg), (udp), LAYOUT_MT)
+#define pushlayout(L, handle) pushxxx((L), (handle))
+
+/* matstack.c */
+#define matstack_t moonglmath_matstack_t
+typedef struct moonglmath_matstack_s matstack_t;
+#define checkmatstack(L, arg, udp) (matstack_t*)checkxxx((L), (arg), (udp), MATSTACK_MT)
+#define testmatstack(L, arg, udp) (matstack_t*)testxxx((L), (arg), (udp), MATSTACK_MT)
+#define pushmatstack(L, handle) pushxxx((L), (handle))
+
+/* camera.c */
+#define camera_t moonglmath_camera_t
+typedef struct moonglmath_camera_s camera_t;
+#define checkcamera(L, arg, udp) (camera_t*)checkxxx((L), (arg), (udp), CAMERA_MT)
+#define testcamera(L, arg, udp) (camera_t*)testxxx((L), (arg), (udp), CAMERA_MT)
+#define pushcamera(L, handle) pushxxx((L), (handle))
+#define CAMERA_VIEW         1   /* derived quantities, for camera_update() */
+#define CAMERA_PROJECTION   2
+#define CAMERA_VIEWPROJ     4
+#define CAMERA_INVVIEWPROJ  8
+#define CAMERA_PLANES       16
+#define camera_update moonglmath_camera_update
+int camera_update(camera_t *cam, unsigned int what);
+#define camera_matrix moonglmath_camera_matrix
+int camera_matrix(camera_t *cam, unsigned int what, mat_t dst);
 
 /* used in main.c */
 void moonglmath_open_hostmem(lua_State *L);
+void moonglmath_open_grid(lua_State *L);
+void moonglmath_open_hierarchy(lua_State *L);
+void moonglmath_open_kernel(lua_State *L);
+void moonglmath_open_layout(lua_State *L);
+void moonglmath_open_matstack(lua_State *L);
+void moonglmath_open_camera(lua_State *L);
 
 #define RAW_FUNC(xxx)                       \
 static int Raw(lua_State *L)                \
@@ -0,0 +1,199 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Stefano Trettel
+ *
+ * Software repository: MoonGLMATH, https://github.com/stetre/moonglmath
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "internal.h"
+
+/* Recycling pool for vec, mat and quat tables.
+ *
+ * Tables explicitly released with glmath.release() are kept in a per-state pool, in the
+ * registry, and reused by pushvec(), pushmat() and pushquat() instead of creating new ones.
+ * Released tables are marked, so that releasing the same table twice raises an error
+ * instead of having it later reused for two different results.
+ */
+
+static int PoolKey; /* registry[&PoolKey] = { [POOL_VEC] = { tables }, ..., capacity = n } */
+static int ReleasedKey; /* released tables have t[&ReleasedKey] = true */
+#define DEFAULT_CAPACITY 256 /* max no. of tables per kind */
+
+/* The pool table is created by the first release() or pool_capacity() in the state,
+ * so that pooltake() costs a single registry lookup if the pool was never used.
+ */
+
+static void PushPoolTable(lua_State *L)
+/* Pushes the pool table of this state, creating it if needed */
+    {
+    if(lua_rawgetp(L, LUA_REGISTRYINDEX, &PoolKey) == LUA_TTABLE) return;
+    lua_pop(L, 1);
+    lua_createtable(L, POOL_NKINDS, 1);
+    lua_pushinteger(L, DEFAULT_CAPACITY);
+    lua_setfield(L, -2, "capacity");
+    lua_pushvalue(L, -1);
+    lua_rawsetp(L, LUA_REGISTRYINDEX, &PoolKey);
+    }
+
+static lua_Integer Capacity(lua_State *L, int pool)
+/* Returns the capacity (pool = stack index of the pool table) */
+    {
+    lua_Integer capacity;
+    lua_getfield(L, pool, "capacity");
+    capacity = lua_tointeger(L, -1);
+    lua_pop(L, 1);
+    return capacity;
+    }
+
+static int PushPool(lua_State *L, int kind)
+/* Pushes the pool list of the given kind, with the pool table below it, creating them 
+ * if needed, and returns its length */
+    {
+    PushPoolTable(L);
+    if(lua_rawgeti(L, -1, kind) != LUA_TTABLE)
+        {
+        lua_pop(L, 1);
+        lua_createtable(L, 16, 0);
+        lua_pushvalue(L, -1);
+        lua_rawseti(L, -3, kind);
+        }
+    return (int)lua_rawlen(L, -1);
+    }
+
+int pooltake(lua_State *L, int kind)
+/* If the pool of the given kind is not empty, removes a table from it, pushes it on 
+ * the stack and returns 1. Otherwise it pushes nothing and returns 0.
+ * The table retains its metatable and its old contents, to be overwritten by the caller.
+ */
+    {
+    int n;
+    if(lua_rawgetp(L, LUA_REGISTRYINDEX, &PoolKey) != LUA_TTABLE)
+        { lua_pop(L, 1); return 0; } /* pool never used in this state */
+    if(lua_rawgeti(L, -1, kind) != LUA_TTABLE || (n = (int)lua_rawlen(L, -1)) == 0)
+        { lua_pop(L, 2); return 0; }
+    lua_rawgeti(L, -1, n);
+    lua_pushnil(L);
+    lua_rawseti(L, -3, n);
+    lua_replace(L, -3);
+    lua_pop(L, 1);
+    lua_pushnil(L);
+    lua_rawsetp(L, -2, &ReleasedKey);
+    return 1;
+    }
+
+static int Kind(lua_State *L, int arg)
+    {
+    switch(typetag(L, arg))
+        {
+        case TAG_VEC: return POOL_VEC;
+        case TAG_MAT: return POOL_MAT;
+        case TAG_QUAT: return POOL_QUAT;
+        default: return 0;
+        }
+    }
+
+static int Recyclable(lua_State *L, int arg, int kind)
+/* Checks that a matrix has the layout created by pushmat() (4 row tables) */
+    {
+    int i, ok = 1;
+    if(kind != POOL_MAT) return 1;
+    for(i = 1; i <= 4 && ok; i++)
+        {
+        ok = (lua_rawgeti(L, arg, i) == LUA_TTABLE);
+        lua_pop(L, 1);
+        }
+    return ok;
+    }
+
+static int Release(lua_State *L)
+/* release(obj1, ...) */
+    {
+    int arg, kind, n;
+    int last = lua_gettop(L);
+    for(arg = 1; arg <= last; arg++)
+        {
+        if(lua_isnil(L, arg)) continue;
+        kind = Kind(L, arg);
+        if(kind == 0)
+            return luaL_argerror(L, arg, "vec, mat or quat expected");
+        if(lua_rawgetp(L, arg, &ReleasedKey) != LUA_TNIL)
+            return luaL_argerror(L, arg, "object already released");
+        lua_pop(L, 1);
+        if(!Recyclable(L, arg, kind)) continue;
+        n = PushPool(L, kind);
+        if(n < Capacity(L, -2))
+            {
+            lua_pushboolean(L, 1);
+            lua_rawsetp(L, arg, &ReleasedKey);
+            lua_pushvalue(L, arg);
+            lua_rawseti(L, -2, n + 1);
+            }
+        lua_pop(L, 2);
+        }
+    return 0;
+    }
+
+static int PoolCapacity(lua_State *L)
+/* old = pool_capacity([capacity]) */
+    {
+    int kind;
+    lua_Integer n, capacity, old;
+    int set = !lua_isnoneornil(L, 1);
+    capacity = set ? luaL_checkinteger(L, 1) : 0;
+    if(capacity < 0)
+        return luaL_argerror(L, 1, errstring(ERR_VALUE));
+    PushPoolTable(L);
+    old = Capacity(L, -1);
+    if(set)
+        {
+        lua_pushinteger(L, capacity);
+        lua_setfield(L, -2, "capacity");
+        for(kind = 1; kind <= POOL_NKINDS; kind++) /* discard the exceeding tables */
+            {
+            n = PushPool(L, kind);
+            for(; n > capacity; n--)
+                {
+                lua_rawgeti(L, -1, n);
+                lua_pushnil(L);
+                lua_rawsetp(L, -2, &ReleasedKey);
+                lua_pop(L, 1);
+                lua_pushnil(L);
+                lua_rawseti(L, -2, n);
+                }
+            lua_pop(L, 2);
+            }
+        }
+    lua_pushinteger(L, old);
+    return 1;
+    }
+
+static const struct luaL_Reg Functions[] = 
+    {
+        { "release", Release },
+        { "pool_capacity", PoolCapacity },
+        { NULL, NULL } /* sentinel */
+    };
+
+void moonglmath_open_pool(lua_State *L)
+    {
+    luaL_setfuncs(L, Functions, 0);
+    }
+
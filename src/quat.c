@@ -35,7 +35,7 @@ int testquat(lua_State *L, int arg, quat_t q)
  */
     {
     size_t i;
-    if(!testmetatable(L, arg, QUAT_MT)) return 0;
+    if(typetag(L, arg) != TAG_QUAT) return 0;
 
     if(q != NULL)
         {
@@ -62,12 +62,15 @@ int checkquat(lua_State *L, int arg, quat_t q)
 int pushquat(lua_State *L, quat_t q)
     {
     size_t i;
-    lua_newtable(L);
-    setmetatable(L, QUAT_MT);
+    if(!pooltake(L, POOL_QUAT))
+        {
+        lua_createtable(L, 4, 0);
+        setmetatable(L, QUAT_MT);
+        }
     for(i=0; i<4; i++)
         {
         lua_pushnumber(L, q[i]);
-        lua_seti(L, -2, i+1);
+        lua_rawseti(L, -2, i+1);
         }
     return 1;
     }
@@ -238,6 +241,18 @@ void quat_normalize(quat_t q)
     for(i=0; i < 4; i++)    
         q[i] = q[i]/norm;
     }
+
+void quat_fast_normalize(quat_t q) 
+/* in place, approximated (see fast_rsqrt()) */
+    {
+    size_t i;
+    double norm2 = quat_norm2(q);
+    double k;
+    if(norm2 == 0) return;
+    k = fast_rsqrt(norm2);
+    for(i=0; i < 4; i++)    
+        q[i] = q[i]*k;
+    }
         
 void quat_conj(quat_t dst, quat_t q) 
     {
@@ -330,6 +345,101 @@ void quat_slerp(quat_t dst, quat_t q, quat_t p, double t)
         }
     }
 
+void quat_nlerp(quat_t dst, quat_t q, quat_t p, double t)
+/* Normalized linear interpolation along the shortest path (q and p are not modified).
+ * Same path as quat_slerp(), but not at constant angular velocity.
+ */
+    {
+    double t1 = 1.0 - t;
+    if((q[0]*p[0] + q[1]*p[1] + q[2]*p[2] + q[3]*p[3]) < 0) t = -t;
+    dst[0] = t1*q[0] + t*p[0];
+    dst[1] = t1*q[1] + t*p[1];
+    dst[2] = t1*q[2] + t*p[2];
+    dst[3] = t1*q[3] + t*p[3];
+    quat_fast_normalize(dst);
+    }
+
+void quat_fast_slerp(quat_t dst, quat_t q, quat_t p, double t)
+/* Approximated slerp between unit quaternions (q and p are not modified), with no 
+ * calls to trigonometric functions. The coefficients sin((1-t)A)/sin(A) and sin(tA)/sin(A)
+ * are computed as truncated series in (cos(A)-1), with the last term corrected to 
+ * minimize the error.
+ * Rfr: D. Eberly, "A Fast and Accurate Algorithm for Computing SLERP",
+ *      Journal of Graphics, GPU, and Game Tools, 15:3, 2011.
+ */
+    {
+#define N 8
+#define MU 1.85298109240830
+    static const double u[N] = { 1.0/(1*3), 1.0/(2*5), 1.0/(3*7), 1.0/(4*9), 
+            1.0/(5*11), 1.0/(6*13), 1.0/(7*15), MU/(8*17) };
+    static const double v[N] = { 1.0/3, 2.0/5, 3.0/7, 4.0/9, 
+            5.0/11, 6.0/13, 7.0/15, MU*8/17 };
+    double x, xm1, d, t2, d2, ct, cd, sign = 1.0;
+    int i;
+    x = q[0]*p[0] + q[1]*p[1] + q[2]*p[2] + q[3]*p[3];
+    if(x < 0) { x = -x; sign = -1.0; } /* take the shortest path */
+    xm1 = x - 1.0;
+    d = 1.0 - t;
+    t2 = t*t;
+    d2 = d*d;
+    ct = cd = 1.0;
+    for(i = N-1; i >= 0; i--)
+        {
+        ct = 1.0 + (u[i]*t2 - v[i])*xm1*ct;
+        cd = 1.0 + (u[i]*d2 - v[i])*xm1*cd;
+        }
+    ct *= t*sign;
+    cd *= d;
+    dst[0] = cd*q[0] + ct*p[0];
+    dst[1] = cd*q[1] + ct*p[1];
+    dst[2] = cd*q[2] + ct*p[2];
+    dst[3] = cd*q[3] + ct*p[3];
+#undef N
+#undef MU
+    }
+
+void quat_frommat(quat_t q, mat_t m)
+/* Extracts the unit quaternion from the rotation matrix in the upper-left 3x3 block of m.
+ * The square root is taken on the largest of w, x, y, z (Shepperd's method), so that the
+ * divisor is never close to zero.
+ */
+    {
+    double t, s;
+    t = m[0][0] + m[1][1] + m[2][2];
+    if(t > 0)
+        {
+        s = 2*sqrt(1 + t);
+        q[0] = 0.25*s;
+        q[1] = (m[2][1] - m[1][2])/s;
+        q[2] = (m[0][2] - m[2][0])/s;
+        q[3] = (m[1][0] - m[0][1])/s;
+        }
+    else if((m[0][0] > m[1][1]) && (m[0][0] > m[2][2]))
+        {
+        s = 2*sqrt(1 + m[0][0] - m[1][1] - m[2][2]);
+        q[0] = (m[2][1] - m[1][2])/s;
+        q[1] = 0.25*s;
+        q[2] = (m[0][1] + m[1][0])/s;
+        q[3] = (m[0][2] + m[2][0])/s;
+        }
+    else if(m[1][1] > m[2][2])
+        {
+        s = 2*sqrt(1 + m[1][1] - m[0][0] - m[2][2]);
+        q[0] = (m[0][2] - m[2][0])/s;
+        q[1] = (m[0][1] + m[1][0])/s;
+        q[2] = 0.25*s;
+        q[3] = (m[1][2] + m[2][1])/s;
+        }
+    else
+        {
+        s = 2*sqrt(1 + m[2][2] - m[0][0] - m[1][1]);
+        q[0] = (m[1][0] - m[0][1])/s;
+        q[1] = (m[0][2] + m[2][0])/s;
+        q[2] = (m[1][2] + m[2][1])/s;
+        q[3] = 0.25*s;
+        }
+    }
+
 /*------------------------------------------------------------------------------*
  | Metamethods                                                                  |
  *------------------------------------------------------------------------------*/
@@ -557,31 +667,12 @@ static int quat_Mat4(lua_State *L)
 int quat_FromMat(lua_State *L)
     {
     size_t nr, nc;
-    double t, s, r;
     mat_t m;
     quat_t q;
     checkmat(L, 1, m, &nr, &nc);
     if( !(((nr==3) && (nc==3)) || ((nr==4) && (nc==4))) )
         return luaL_argerror(L, 1, "expected 3x3 or 4x4 matrix");
-    t = m[0][0] + m[1][1] + m[2][2];
-    if( t < 0 )
-        {
-        r = sqrt(1 + m[0][0] - m[1][1] - m[2][2]);
-        s = 0.5/r;
-        q[0] = (m[2][1] - m[1][2])*s;
-        q[1] = 0.5*r;
-        q[2] = (m[0][1] + m[1][0])*s;
-        q[3] = (m[2][0] + m[0][2])*s;
-        }
-    else
-        {
-        r = sqrt(1+t);
-        s = 0.5/r;
-        q[0] = 0.5*r;
-        q[1] = (m[2][1] - m[1][2])*s;
-        q[2] = (m[0][2] - m[2][0])*s;
-        q[3] = (m[1][0] + m[0][1])*s;
-        }
+    quat_frommat(q, m);
     return pushquat(L, q);
     }
 
@@ -597,6 +688,36 @@ int quat_Mix(lua_State *L)
     return pushquat(L, dst);
     }
 
+int quat_FastNormalize(lua_State *L)
+    {
+    quat_t q;
+    checkquat(L, 1, q);
+    quat_fast_normalize(q);
+    return pushquat(L, q);
+    }
+
+int quat_Nlerp(lua_State *L)
+    {
+    quat_t dst, q, p;
+    double t;
+    checkquat(L, 1, q);
+    checkquat(L, 2, p);
+    t = luaL_checknumber(L, 3);
+    quat_nlerp(dst, q, p, t);
+    return pushquat(L, dst);
+    }
+
+int quat_FastSlerp(lua_State *L)
+    {
+    quat_t dst, q, p;
+    double t;
+    checkquat(L, 1, q);
+    checkquat(L, 2, p);
+    t = luaL_checknumber(L, 3);
+    quat_fast_slerp(dst, q, p, t);
+    return pushquat(L, dst);
+    }
+
 int quat_Slerp(lua_State *L)
     {
     quat_t dst, q, p;
@@ -612,6 +733,55 @@ int quat_Slerp(lua_State *L)
 //@@ TODO rotate()
 //@@ TODO quaternion <-> Euler
 
+/*------------------------------------------------------------------------------*
+ | Named components                                                             |
+ *------------------------------------------------------------------------------*/
+
+static int Component(const char *key, size_t len)
+/* Returns the index (1..4) of the component named key (w, x, y, z), or 0 */
+    {
+    if(len != 1) return 0;
+    switch(key[0])
+        {
+        case 'w': return 1;
+        case 'x': return 2;
+        case 'y': return 3;
+        case 'z': return 4;
+        }
+    return 0;
+    }
+
+static int Index(lua_State *L)
+/* __index metamethod: q.w, q.x, q.y, q.z, and methods (upvalue 1 is the metatable) */
+    {
+    size_t len;
+    int i;
+    const char *key;
+    if(lua_type(L, 2) != LUA_TSTRING)
+        { lua_pushnil(L); return 1; }
+    key = lua_tolstring(L, 2, &len);
+    if((i = Component(key, len)) != 0)
+        lua_rawgeti(L, 1, i);
+    else
+        lua_rawget(L, lua_upvalueindex(1));
+    return 1;
+    }
+
+static int NewIndex(lua_State *L)
+/* __newindex metamethod: q.w = val, ... */
+    {
+    size_t len;
+    int i;
+    const char *key;
+    if(lua_type(L, 2) == LUA_TNUMBER)
+        { lua_rawset(L, 1); return 0; }
+    key = lua_tolstring(L, 2, &len);
+    if(lua_type(L, 2) != LUA_TSTRING || (i = Component(key, len)) == 0)
+        return luaL_error(L, "cannot write field '%s'", key ? key : "?");
+    lua_rawseti(L, 1, i);
+    return 0;
+    }
+
 static const struct luaL_Reg Metamethods[] = 
     {
         { "__tostring", ToString },
@@ -632,11 +802,14 @@ static const struct luaL_Reg Methods[] =
         { "norm", quat_Norm },
         { "norm2", quat_Norm2 },
         { "normalize", quat_Normalize },
+        { "fast_normalize", quat_FastNormalize },
         { "inv", quat_Inv },
         { "mat3", quat_Mat3 },
         { "mat4", quat_Mat4 },
         { "mix", quat_Mix },
         { "slerp", quat_Slerp },
+        { "nlerp", quat_Nlerp },
+        { "fast_slerp", quat_FastSlerp },
         { NULL, NULL } /* sentinel */
     };
 
@@ -655,7 +828,16 @@ static const struct luaL_Reg Functions[] =
 void moonglmath_open_quat(lua_State *L)
     {
     newmetatable(L, QUAT_MT);
+    settypetag(L, QUAT_MT, TAG_QUAT);
     metatable_setfuncs(L, QUAT_MT, Metamethods, Methods);
+    /* replace metatable.__index = metatable with the Index() closure */
+    luaL_getmetatable(L, QUAT_MT);
+    lua_pushvalue(L, -1);
+    lua_pushcclosure(L, Index, 1);
+    lua_setfield(L, -2, "__index");
+    lua_pushcfunction(L, NewIndex);
+    lua_setfield(L, -2, "__newindex");
+    lua_pop(L, 1);
     luaL_setfuncs(L, Functions, 0);
     }
 
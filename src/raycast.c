@@ -0,0 +1,238 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Stefano Trettel
+ *
+ * Software repository: MoonGLMATH, https://github.com/stetre/moonglmath
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "internal.h"
+
+/* Ray intersection kernels.
+ *
+ * The geometry is passed as a packed array of boxes (minx, maxx, miny, maxy, minz, maxz),
+ * spheres (cx, cy, cz, radius), or triangles (x1, y1, z1, x2, y2, z2, x3, y3, z3). 
+ * A ray is either given as an origin and a direction vector, or as an element of a packed
+ * array of rays (ox, oy, oz, dx, dy, dz). 
+ *
+ * The kernels loop over the geometry in the outer loop and over the rays in the inner loop,
+ * so that each element is fetched (and converted to double) only once per packet. Each ray
+ * of the packet is still tested on its own, with the same scalar code as a single ray.
+ */
+
+enum { BOXES, SPHERES, TRIANGLES };
+static const size_t Nvalues[] = { 6, 4, 9 }; /* values per geometry element */
+
+typedef struct {
+    double o[3]; /* origin */
+    double d[3]; /* direction */
+    double inv[3]; /* 1/direction */
+    double t; /* distance of the nearest hit so far (in units of |d|) */
+    double u, v; /* barycentric coordinates of the nearest hit (triangles only) */
+    size_t index; /* index of the nearest hit (1-based), or 0 */
+} ray_t;
+
+/* A hit at distance t is nearer than the nearest hit so far, or is the first hit within
+ * tmax (ray->t starts at tmax, which is included in the range). */
+#define CLOSER(ray, d) (((d) < (ray)->t) || ((ray)->index == 0 && (d) <= (ray)->t))
+
+#define DOT(a, b) ((a)[0]*(b)[0] + (a)[1]*(b)[1] + (a)[2]*(b)[2])
+#define SUB(r, a, b) do { (r)[0] = (a)[0] - (b)[0]; (r)[1] = (a)[1] - (b)[1]; (r)[2] = (a)[2] - (b)[2]; } while(0)
+#define CROSS(r, a, b) do {                 \
+    (r)[0] = (a)[1]*(b)[2] - (a)[2]*(b)[1]; \
+    (r)[1] = (a)[2]*(b)[0] - (a)[0]*(b)[2]; \
+    (r)[2] = (a)[0]*(b)[1] - (a)[1]*(b)[0]; \
+} while(0)
+
+static void HitBox(ray_t *ray, const double *b, size_t index)
+/* Slab test. A ray starting inside the box hits it at t = 0 */
+    {
+    int i;
+    double t1, t2, tmp, tnear = 0, tfar = ray->t;
+    for(i = 0; i < 3; i++)
+        {
+        t1 = (b[2*i] - ray->o[i]) * ray->inv[i];
+        t2 = (b[2*i+1] - ray->o[i]) * ray->inv[i];
+        if(t1 > t2) { tmp = t1; t1 = t2; t2 = tmp; }
+        /* NaNs (0*inf, for rays parallel to and lying on a slab plane) are ignored */
+        if(t1 > tnear) tnear = t1;
+        if(t2 < tfar) tfar = t2;
+        if(tnear > tfar) return;
+        }
+    if(CLOSER(ray, tnear))
+        { ray->t = tnear; ray->index = index; }
+    }
+
+static void HitSphere(ray_t *ray, const double *s, size_t index)
+/* A ray starting inside the sphere hits it where it exits */
+    {
+    double oc[3], a, b, c, disc, sq, t;
+    SUB(oc, ray->o, s);
+    a = DOT(ray->d, ray->d);
+    b = DOT(oc, ray->d);
+    c = DOT(oc, oc) - s[3]*s[3];
+    disc = b*b - a*c;
+    if(disc < 0 || a == 0) return;
+    sq = sqrt(disc);
+    t = (-b - sq) / a;
+    if(t < 0) t = (-b + sq) / a;
+    if((t >= 0) && CLOSER(ray, t))
+        { ray->t = t; ray->index = index; }
+    }
+
+static void HitTriangle(ray_t *ray, const double *v, size_t index)
+/* Möller-Trumbore, double sided */
+    {
+    double e1[3], e2[3], p[3], q[3], s[3], det, inv, u, w, t;
+    SUB(e1, v+3, v);
+    SUB(e2, v+6, v);
+    CROSS(p, ray->d, e2);
+    det = DOT(e1, p);
+    /* parallel to the triangle plane, or degenerate (relative test, since det scales
+     * with |e1|*|e2|*|d|: det is the triple product d . (e1 x e2), compared squared) */
+    if(det*det <= 1e-24 * DOT(e1, e1) * DOT(e2, e2) * DOT(ray->d, ray->d)) return;
+    inv = 1.0 / det;
+    SUB(s, ray->o, v);
+    u = DOT(s, p) * inv;
+    if(u < 0 || u > 1) return;
+    CROSS(q, s, e1);
+    w = DOT(ray->d, q) * inv;
+    if(w < 0 || (u + w) > 1) return;
+    t = DOT(e2, q) * inv;
+    if((t >= 0) && CLOSER(ray, t))
+        { ray->t = t; ray->index = index; ray->u = u; ray->v = w; }
+    }
+
+static void Cast(int kind, ray_t *rays, size_t nrays, const char *geom, size_t count, int type)
+    {
+    size_t i, j, k, n = Nvalues[kind];
+    double g[9];
+    for(i = 0; i < count; i++)
+        {
+        for(k = 0; k < n; k++)
+            g[k] = getreal(geom, type, i*n + k);
+        switch(kind)
+            {
+            case BOXES: for(j = 0; j < nrays; j++) HitBox(&rays[j], g, i+1); break;
+            case SPHERES: for(j = 0; j < nrays; j++) HitSphere(&rays[j], g, i+1); break;
+            case TRIANGLES: for(j = 0; j < nrays; j++) HitTriangle(&rays[j], g, i+1); break;
+            }
+        }
+    }
+
+static void InitRay(ray_t *ray, double tmax)
+    {
+    int i;
+    for(i = 0; i < 3; i++)
+        ray->inv[i] = 1.0 / ray->d[i];
+    ray->t = tmax;
+    ray->u = ray->v = 0;
+    ray->index = 0;
+    }
+
+/*------------------------------------------------------------------------------*
+ | Lua functions                                                                |
+ *------------------------------------------------------------------------------*/
+
+static int RaySingle(lua_State *L, int kind)
+/* index, t [, u, v] = ray_xxx(origin, direction, geom, [count], [type], [tmax]) */
+    {
+    vec_t o, d;
+    ray_t ray;
+    size_t count;
+    const char *geom;
+    int type = checkrealtype(L, 5);
+    double tmax = luaL_optnumber(L, 6, HUGE_VAL);
+    checkvec(L, 1, o, NULL, NULL);
+    checkvec(L, 2, d, NULL, NULL);
+    geom = checkhostmemarray(L, 3, 4, Nvalues[kind] * sizeoftype(type), &count);
+    memcpy(ray.o, o, sizeof(ray.o));
+    memcpy(ray.d, d, sizeof(ray.d));
+    InitRay(&ray, tmax);
+    Cast(kind, &ray, 1, geom, count, type);
+    if(ray.index == 0)
+        { lua_pushnil(L); return 1; }
+    lua_pushinteger(L, ray.index);
+    lua_pushnumber(L, ray.t);
+    if(kind != TRIANGLES) return 2;
+    lua_pushnumber(L, ray.u);
+    lua_pushnumber(L, ray.v);
+    return 4;
+    }
+
+static int RayPacket(lua_State *L, int kind)
+/* {index}, {t} = ray_xxx(rays, [nrays], geom, [count], [type], [tmax]) */
+    {
+    size_t i, k, nrays, count;
+    const char *geom, *rp;
+    ray_t *rays;
+    int type = checkrealtype(L, 5);
+    double tmax = luaL_optnumber(L, 6, HUGE_VAL);
+    rp = checkhostmemarray(L, 1, 2, 6 * sizeoftype(type), &nrays);
+    geom = checkhostmemarray(L, 3, 4, Nvalues[kind] * sizeoftype(type), &count);
+    lua_createtable(L, nrays, 0);
+    lua_createtable(L, nrays, 0);
+    if(nrays == 0) return 2;
+    rays = (ray_t*)Malloc(L, nrays * sizeof(ray_t));
+    for(i = 0; i < nrays; i++)
+        {
+        for(k = 0; k < 3; k++)
+            {
+            rays[i].o[k] = getreal(rp, type, 6*i + k);
+            rays[i].d[k] = getreal(rp, type, 6*i + 3 + k);
+            }
+        InitRay(&rays[i], tmax);
+        }
+    Cast(kind, rays, nrays, geom, count, type);
+    for(i = 0; i < nrays; i++)
+        {
+        lua_pushinteger(L, rays[i].index);
+        lua_rawseti(L, -3, i+1);
+        lua_pushnumber(L, rays[i].index ? rays[i].t : HUGE_VAL);
+        lua_rawseti(L, -2, i+1);
+        }
+    Free(L, rays);
+    return 2;
+    }
+
+static int Ray(lua_State *L, int kind)
+    {
+    if(testhostmem(L, 1, NULL))
+        return RayPacket(L, kind);
+    return RaySingle(L, kind);
+    }
+
+static int RayBoxes(lua_State *L) { return Ray(L, BOXES); }
+static int RaySpheres(lua_State *L) { return Ray(L, SPHERES); }
+static int RayTriangles(lua_State *L) { return Ray(L, TRIANGLES); }
+
+static const struct luaL_Reg Functions[] = 
+    {
+        { "ray_boxes", RayBoxes },
+        { "ray_spheres", RaySpheres },
+        { "ray_triangles", RayTriangles },
+        { NULL, NULL } /* sentinel */
+    };
+
+void moonglmath_open_raycast(lua_State *L)
+    {
+    luaL_setfuncs(L, Functions, 0);
+    }
+
@@ -33,7 +33,7 @@ int testrect(lua_State *L, int arg, rect_t r)
 /* Tests if the element at arg is a rect and sets r accordingly */
     {
     size_t i;
-    if(!testmetatable(L, arg, RECT_MT)) return 0;
+    if(typetag(L, arg) != TAG_RECT) return 0;
 
     if(r != NULL)
         {
@@ -187,6 +187,7 @@ static const struct luaL_Reg Functions[] =
 void moonglmath_open_rect(lua_State *L)
     {
     newmetatable(L, RECT_MT);
+    settypetag(L, RECT_MT, TAG_RECT);
     metatable_setfuncs(L, RECT_MT, Metamethods, Methods);
     luaL_setfuncs(L, Functions, 0);
     }
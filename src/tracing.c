@@ -29,6 +29,12 @@ static int Type(lua_State *L)
     {
 #define TRY(xxx) do { if(test##xxx(L, 1, NULL) != 0) { lua_pushstring(L, ""#xxx); return 1; } } while(0)
     TRY(hostmem);
+    TRY(grid);
+    TRY(hierarchy);
+    TRY(kernel);
+    TRY(layout);
+    TRY(matstack);
+    TRY(camera);
     return 0;
 #undef TRY
     }
@@ -59,7 +59,7 @@ void scale(mat_t m, double x, double y, double z)
     m[3][3] = 1.0;
     }
 
-static void rotate(mat_t m, double x, double y, double z, double rad)
+void rotate(mat_t m, double x, double y, double z, double rad)
 /* c+(1-c)x^2  (1-c)xy-sz (1-c)xz+sy  0
  * (1-c)xy+sz  c+(1-c)y^2 (1-c)yz-sx  0
  * (1-c)xz-sy  (1-c)yz+sx c+(1-c)z^2  0
@@ -137,6 +137,68 @@ void rotate_z(mat_t m, double rad)
     m[1][0] = s;
     }
 
+void compose_trs(mat_t m, vec_t t, quat_t q, vec_t s)
+/* Computes m = T(t) * R(q) * S(s) in closed form:
+ *
+ * r00*sx r01*sy r02*sz tx
+ * r10*sx r11*sy r12*sz ty
+ * r20*sx r21*sy r22*sz tz
+ *   0      0      0    1
+ *
+ * where r is the rotation matrix for the quaternion q (which needs not be normalized).
+ */
+    {
+    double n, wx, wy, wz, xx, yy, zz, xy, xz, yz;
+    n = q[0]*q[0] + q[1]*q[1] + q[2]*q[2] + q[3]*q[3];
+    n = n > 0 ? 2 / n : 0;
+    wx = n*q[0]*q[1]; wy = n*q[0]*q[2]; wz = n*q[0]*q[3];
+    xx = n*q[1]*q[1]; yy = n*q[2]*q[2]; zz = n*q[3]*q[3];
+    xy = n*q[1]*q[2]; xz = n*q[1]*q[3]; yz = n*q[2]*q[3];
+    m[0][0] = (1 - yy - zz)*s[0];
+    m[0][1] = (xy - wz)*s[1];
+    m[0][2] = (xz + wy)*s[2];
+    m[0][3] = t[0];
+    m[1][0] = (xy + wz)*s[0];
+    m[1][1] = (1 - xx - zz)*s[1];
+    m[1][2] = (yz - wx)*s[2];
+    m[1][3] = t[1];
+    m[2][0] = (xz - wy)*s[0];
+    m[2][1] = (yz + wx)*s[1];
+    m[2][2] = (1 - xx - yy)*s[2];
+    m[2][3] = t[2];
+    m[3][0] = m[3][1] = m[3][2] = 0;
+    m[3][3] = 1;
+    }
+
+void decompose_trs(vec_t t, quat_t q, vec_t s, mat_t m)
+/* Inverse of compose_trs(), for an affine matrix m without shear. A negative determinant
+ * (i.e. a reflection) is accounted for by negating the x scale factor.
+ */
+    {
+    mat_t r;
+    int i, j;
+    vec_clear(t);
+    vec_clear(s);
+    mat_clear(r);
+    for(j = 0; j < 3; j++)
+        {
+        t[j] = m[j][3];
+        s[j] = sqrt(m[0][j]*m[0][j] + m[1][j]*m[1][j] + m[2][j]*m[2][j]);
+        }
+    if(mat_det3(m) < 0) s[0] = -s[0];
+    for(j = 0; j < 3; j++)
+        {
+        if(s[j] == 0) /* degenerate: pick the identity for this axis */
+            { r[j][j] = 1; continue; }
+        for(i = 0; i < 3; i++)
+            r[i][j] = m[i][j] / s[j];
+        }
+    quat_frommat(q, r);
+    }
+
+/*------------------------------------------------------------------------------*
+ | Lua functions                                                                |
+ *------------------------------------------------------------------------------*/
 
 static int Translate(lua_State *L)
     {
@@ -212,6 +274,102 @@ static int RotateZ(lua_State *L)
     return pushmat(L, m, 4, 4, 4, 4);
     }
 
+static int ComposeTRSArray(lua_State *L)
+/* compose_trs(src, [count], dst, [type]) */
+    {
+    size_t i, count;
+    char *src, *dst;
+    vec_t t, s;
+    quat_t q;
+    mat_t m;
+    int k, r, c, type = checkrealtype(L, 4);
+    src = checkhostmemarray(L, 1, 2, 10 * sizeoftype(type), &count);
+    dst = checkhostmemarray(L, 3, 0, 16 * sizeoftype(type), &count);
+    for(i = 0; i < count; i++)
+        {
+        for(k = 0; k < 3; k++)
+            {
+            t[k] = getreal(src, type, 10*i + k);
+            s[k] = getreal(src, type, 10*i + 7 + k);
+            }
+        for(k = 0; k < 4; k++)
+            q[k] = getreal(src, type, 10*i + 3 + k);
+        compose_trs(m, t, q, s);
+        for(r = 0; r < 4; r++)
+            for(c = 0; c < 4; c++)
+                setreal(dst, type, 16*i + 4*r + c, m[r][c]);
+        }
+    return 0;
+    }
+
+static int ComposeTRS(lua_State *L)
+/* m = compose_trs(t, [q], [s]) */
+    {
+    vec_t t, s;
+    quat_t q = { 1, 0, 0, 0 };
+    mat_t m;
+    if(testhostmem(L, 1, NULL))
+        return ComposeTRSArray(L);
+    checkvec(L, 1, t, NULL, NULL);
+    if(!lua_isnoneornil(L, 2))
+        checkquat(L, 2, q);
+    if(lua_isnoneornil(L, 3))
+        s[0] = s[1] = s[2] = 1;
+    else if(lua_isnumber(L, 3))
+        s[0] = s[1] = s[2] = lua_tonumber(L, 3);
+    else
+        checkvec(L, 3, s, NULL, NULL);
+    compose_trs(m, t, q, s);
+    return pushmat(L, m, 4, 4, 4, 4);
+    }
+
+static int DecomposeArray(lua_State *L)
+/* decompose(src, [count], dst, [type]) */
+    {
+    size_t i, count;
+    char *src, *dst;
+    vec_t t, s;
+    quat_t q;
+    mat_t m;
+    int k, r, c, type = checkrealtype(L, 4);
+    src = checkhostmemarray(L, 1, 2, 16 * sizeoftype(type), &count);
+    dst = checkhostmemarray(L, 3, 0, 10 * sizeoftype(type), &count);
+    for(i = 0; i < count; i++)
+        {
+        for(r = 0; r < 4; r++)
+            for(c = 0; c < 4; c++)
+                m[r][c] = getreal(src, type, 16*i + 4*r + c);
+        decompose_trs(t, q, s, m);
+        for(k = 0; k < 3; k++)
+            {
+            setreal(dst, type, 10*i + k, t[k]);
+            setreal(dst, type, 10*i + 7 + k, s[k]);
+            }
+        for(k = 0; k < 4; k++)
+            setreal(dst, type, 10*i + 3 + k, q[k]);
+        }
+    return 0;
+    }
+
+static int Decompose(lua_State *L)
+/* t, q, s = decompose(m) */
+    {
+    vec_t t, s;
+    quat_t q;
+    mat_t m;
+    size_t nr, nc;
+    if(testhostmem(L, 1, NULL))
+        return DecomposeArray(L);
+    checkmat(L, 1, m, &nr, &nc);
+    if((nr < 3) || (nc != 4))
+        return luaL_argerror(L, 1, "expected 4x4 or 3x4 matrix");
+    decompose_trs(t, q, s, m);
+    pushvec(L, t, 3, 3, 0);
+    pushquat(L, q);
+    pushvec(L, s, 3, 3, 0);
+    return 3;
+    }
+
 /*------------------------------------------------------------------------------*
  | Registration                                                                 |
  *------------------------------------------------------------------------------*/
@@ -224,6 +382,8 @@ static const struct luaL_Reg Functions[] =
         { "rotate_x", RotateX },
         { "rotate_y", RotateY },
         { "rotate_z", RotateZ },
+        { "compose_trs", ComposeTRS },
+        { "decompose", Decompose },
         { NULL, NULL } /* sentinel */
     };
 
@@ -86,6 +86,23 @@ void *MallocNoErr(lua_State *L, size_t size) /* do not raise errors (check the r
     return ptr;
     }
 
+void *Realloc(lua_State *L, void *ptr, size_t oldsize, size_t newsize)
+/* Resizes a memory area allocated with Malloc() (or NULL). The newly added part, if any,
+ * is initialized to 0. Raises an error if the reallocation fails (in which case the
+ * original area is left unchanged).
+ */
+    {
+    char *newptr;
+    if(newsize == 0)
+        { luaL_error(L, errstring(ERR_MALLOC_ZERO)); return NULL; }
+    newptr = Alloc ? (char*)Alloc(AllocUd, ptr, ptr ? oldsize : 0, newsize) : NULL;
+    if(newptr==NULL)
+        { luaL_error(L, errstring(ERR_MEMORY)); return NULL; }
+    if(newsize > oldsize)
+        memset(newptr + oldsize, 0, newsize - oldsize);
+    return newptr;
+    }
+
 char *Strdup(lua_State *L, const char *s)
     {
     size_t len = strnlen(s, 256);
@@ -213,16 +230,139 @@ int setmetatable(lua_State *L, const char *metatable)
     }
 
 int testmetatable(lua_State *L, int arg, const char *metatable)
-/* Tests the metatable of the table at index arg */
+/* Tests the metatable of the table at index arg (or its family, for shape metatables) */
     {
     int ok = 0;
     if(lua_getmetatable(L, arg) == 0) return 0;
     luaL_getmetatable(L, metatable);
     ok = lua_compare(L, -1, -2, LUA_OPEQ);
+    lua_pop(L, 1);
+    lua_pushliteral(L, "__family");
+    if(!ok && lua_rawget(L, -2) == LUA_TSTRING)
+        ok = (strcmp(lua_tostring(L, -1), metatable) == 0);
     lua_pop(L, 2);
     return ok;
     }
 
+static int TagKey; /* metatable[&TagKey] = type tag (TAG_XXX) */
+
+int settypetag(lua_State *L, const char *metatable, int tag)
+/* Sets the type tag for the objects having the given metatable.
+ * (Shape metatables created afterwards with newshapemetatable() inherit it).
+ */
+    {
+    luaL_getmetatable(L, metatable);
+    lua_pushinteger(L, tag);
+    lua_rawsetp(L, -2, &TagKey);
+    lua_pop(L, 1);
+    return 0;
+    }
+
+int typetag(lua_State *L, int arg)
+/* Returns the type tag of the value at index arg, or TAG_NONE if it is not a
+ * MoonGLMATH table type. This needs a single lookup, so polymorphic functions can
+ * dispatch with a switch instead of testing the metatables one by one.
+ */
+    {
+    int tag = TAG_NONE;
+    if(lua_getmetatable(L, arg) == 0) return TAG_NONE;
+    if(lua_rawgetp(L, -1, &TagKey) == LUA_TNUMBER)
+        tag = lua_tointeger(L, -1);
+    lua_pop(L, 2);
+    return tag;
+    }
+
+static const char *Events[] = {
+    "__index", "__newindex", "__tostring", "__concat", "__call", "__eq", "__lt", "__le",
+    "__unm", "__add", "__sub", "__mul", "__div", "__mod", "__pow", "__idiv",
+    "__band", "__bor", "__bxor", "__shl", "__shr", "__bnot", NULL
+};
+
+static int Forward(lua_State *L)
+/* Forwarding metamethod of a shape metatable: calls the same metamethod of the
+ * family metatable (upvalue 1), as it is at call time (upvalue 2 is the event name).
+ */
+    {
+    int n = lua_gettop(L);
+    const char *event = lua_tostring(L, lua_upvalueindex(2));
+    lua_pushvalue(L, lua_upvalueindex(2));
+    switch(lua_rawget(L, lua_upvalueindex(1)))
+        {
+        case LUA_TFUNCTION: break;
+        case LUA_TNIL:
+            /* no such metamethod in the family: behave as if it were not there */
+            if(strcmp(event, "__index") == 0) return 0;
+            if(strcmp(event, "__newindex") == 0)
+                { lua_settop(L, 3); lua_rawset(L, 1); return 0; }
+            if(strcmp(event, "__eq") == 0)
+                { lua_pushboolean(L, 0); return 1; }
+            if(strcmp(event, "__tostring") == 0)
+                { lua_pushfstring(L, "table: %p", lua_topointer(L, 1)); return 1; }
+            return luaL_error(L, "attempt to use a %s value (no %s metamethod)",
+                        luaL_typename(L, 1), event);
+        default:
+            if(strcmp(event, "__index") == 0) /* e.g. __index = table */
+                { lua_pushvalue(L, 2); lua_gettable(L, -2); return 1; }
+            if(strcmp(event, "__newindex") == 0)
+                { lua_pushvalue(L, 2); lua_pushvalue(L, 3); lua_settable(L, -3); return 0; }
+            break; /* let the call fail, as Lua would do */
+        }
+    lua_insert(L, 1);
+    lua_call(L, n, LUA_MULTRET);
+    return lua_gettop(L);
+    }
+
+int newshapemetatable(lua_State *L, const char *family, const char *name, const void *key)
+/* Creates a metatable for a specific shape of the objects of a family (e.g. for vec3),
+ * plus a __family field with the family name, so that testmetatable(family) accepts it.
+ * The metamethods of the new metatable forward to those of the family metatable, as they
+ * are at call time, and its __metatable field is the family metatable, so that
+ * getmetatable() returns it and any customization of it applies to all the shapes.
+ * The type tag (and any other non-string key) is copied from the family metatable.
+ * The new metatable is stored in the registry both as 'name' and with the given key (for
+ * faster access), and left on top of the stack, so that the caller can override some of its
+ * metamethods with specialized versions.
+ */
+    {
+    int i;
+    luaL_newmetatable(L, name);
+    luaL_getmetatable(L, family);
+    lua_pushnil(L);
+    while(lua_next(L, -2))
+        {
+        if(lua_type(L, -2) == LUA_TSTRING)
+            {
+            /* forward also any other metamethod the family already has (e.g. __len) */
+            const char *field = lua_tostring(L, -2);
+            if(strncmp(field, "__", 2) == 0 && strcmp(field, "__name") != 0)
+                {
+                lua_pushvalue(L, -3);
+                lua_pushvalue(L, -3);
+                lua_pushcclosure(L, Forward, 2);
+                lua_replace(L, -2);
+                }
+            else
+                { lua_pop(L, 1); continue; }
+            }
+        lua_pushvalue(L, -2);
+        lua_insert(L, -2);
+        lua_rawset(L, -5);
+        }
+    for(i = 0; Events[i] != NULL; i++)
+        {
+        lua_pushvalue(L, -1);
+        lua_pushstring(L, Events[i]);
+        lua_pushcclosure(L, Forward, 2);
+        lua_setfield(L, -3, Events[i]);
+        }
+    lua_setfield(L, -2, "__metatable");
+    lua_pushstring(L, family);
+    lua_setfield(L, -2, "__family");
+    lua_pushvalue(L, -1);
+    lua_rawsetp(L, LUA_REGISTRYINDEX, key);
+    return 0;
+    }
+
 int checkmetatable(lua_State *L, int arg, const char *metatable)
 /* Tests the metatable of the table at index arg */
     {
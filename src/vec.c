@@ -37,7 +37,7 @@ int testvec(lua_State *L, int arg, vec_t v, size_t *size, unsigned int *isrow)
     size_t i;
     size_t size_;
     unsigned int isrow_;
-    if(!testmetatable(L, arg, VEC_MT)) return 0;
+    if(typetag(L, arg) != TAG_VEC) return 0;
 
     lua_getfield(L, arg, "type");   
     isrow_ = checkisrow(L, -1);
@@ -73,25 +73,52 @@ int checkvec(lua_State *L, int arg, vec_t v, size_t *size, unsigned int *isrow)
     }
 
 
+static int ShapeKey[2][5]; /* registry[&ShapeKey[isrow][size]] = shape metatable (size=2,3,4) */
+
+static void setshapemetatable(lua_State *L, size_t size, unsigned int isrow)
+/* Sets the metatable for the given shape to the table on top of the stack */
+    {
+    if(size < 2)
+        luaL_getmetatable(L, VEC_MT);
+    else
+        lua_rawgetp(L, LUA_REGISTRYINDEX, &ShapeKey[isrow ? 1 : 0][size]);
+    lua_setmetatable(L, -2);
+    }
+
 int pushvec(lua_State *L, vec_t v, size_t vsize, size_t size, unsigned int isrow)
 /* vsize = no. of valid elements in v
  * if vsize > size, the exceeding elements are discarded,
  * if vsize < size, the missing elements are set to 0.
  */
     {
-    size_t i;
+    size_t i, oldsize = 0;
     checkvecsize(L, size);
-    lua_newtable(L);
-    setmetatable(L, VEC_MT);
+    if(pooltake(L, POOL_VEC))
+        {
+        lua_getfield(L, -1, "size");
+        oldsize = lua_tointeger(L, -1);
+        lua_pop(L, 1);
+        }
+    else
+        lua_createtable(L, size, 2);
+    setshapemetatable(L, size, isrow);
     for(i=0; i<size; i++)
         {
         lua_pushnumber(L, i < vsize ? v[i] : 0);
-        lua_seti(L, -2, i+1);
+        lua_rawseti(L, -2, i+1);
+        }
+    for(i=size; i<oldsize; i++) /* recycled from a larger vector */
+        {
+        lua_pushnil(L);
+        lua_rawseti(L, -2, i+1);
         }
+    /* raw sets, not to go through the __newindex metamethod */
+    lua_pushliteral(L, "size");
     lua_pushinteger(L, size);
-    lua_setfield(L, -2, "size");
+    lua_rawset(L, -3);
+    lua_pushliteral(L, "type");
     pushisrow(L, isrow);
-    lua_setfield(L, -2, "type");
+    lua_rawset(L, -3);
     return 1;
     }
 
@@ -285,6 +312,18 @@ void vec_normalize(vec_t v, size_t n)
     for(i=0; i < n; i++)    
         v[i] = v[i]/norm;
     }
+
+void vec_fast_normalize(vec_t v, size_t n) 
+/* in place, approximated (see fast_rsqrt()) */
+    {
+    size_t i;
+    double norm2 = vec_norm2(v, n);
+    double k;
+    if(norm2 == 0) return;
+    k = fast_rsqrt(norm2);
+    for(i=0; i < n; i++)    
+        v[i] = v[i]*k;
+    }
     
 void vec_div(vec_t dst, vec_t v, double s, size_t n)
     {
@@ -545,6 +584,16 @@ int vec_Normalize(lua_State *L)
     return pushvec(L, v, size, size, isrow);
     }
 
+int vec_FastNormalize(lua_State *L)
+    {
+    vec_t v; 
+    size_t size; 
+    unsigned int isrow;
+    checkvec(L, 1, v, &size, &isrow);
+    vec_fast_normalize(v, size);
+    return pushvec(L, v, size, size, isrow);
+    }
+
 
 int vec_Transpose(lua_State *L)
     {
@@ -674,6 +723,256 @@ int vec_Fade(lua_State *L)
     }
 
 
+/*------------------------------------------------------------------------------*
+ | Named components and swizzles                                                |
+ *------------------------------------------------------------------------------*/
+
+/* Component[c] = index (1..4) of the component named c, or 0 if c is not a component name.
+ * ComponentSet[c] = the set the name belongs to (1=xyzw, 2=rgba, 3=stpq), since the
+ * components of a swizzle must be all from the same set (as in GLSL). */
+static unsigned char Component[256];
+static unsigned char ComponentSet[256];
+
+static void InitComponents(void)
+    {
+    const char *sets[] = { "xyzw", "rgba", "stpq" };
+    int i, j;
+    for(i = 0; i < 3; i++)
+        for(j = 0; j < 4; j++)
+            {
+            Component[(unsigned char)sets[i][j]] = j + 1;
+            ComponentSet[(unsigned char)sets[i][j]] = i + 1;
+            }
+    }
+
+static int Swizzle(const char *key, size_t len, int index[4], int *unique)
+/* Decodes a swizzle of 2 to 4 components, returning 0 if key is not a valid swizzle */
+    {
+    size_t i, j;
+    unsigned char set = ComponentSet[(unsigned char)key[0]];
+    if(len < 2 || len > 4 || set == 0) return 0;
+    *unique = 1;
+    for(i = 0; i < len; i++)
+        {
+        if(ComponentSet[(unsigned char)key[i]] != set) return 0;
+        index[i] = Component[(unsigned char)key[i]];
+        for(j = 0; j < i; j++)
+            if(index[j] == index[i]) *unique = 0;
+        }
+    return 1;
+    }
+
+static int Index(lua_State *L)
+/* __index metamethod: v.x, v.g, ... (named components), v.xyz, v.bgr, ... (swizzles), 
+ * and methods (upvalue 1 is the metatable) */
+    {
+    size_t len, size, i;
+    unsigned int isrow;
+    int index[4], unique;
+    const char *key;
+    vec_t v, w;
+    if(lua_type(L, 2) != LUA_TSTRING)
+        { lua_pushnil(L); return 1; }
+    key = lua_tolstring(L, 2, &len);
+    if(len == 1 && Component[(unsigned char)key[0]])
+        {
+        lua_rawgeti(L, 1, Component[(unsigned char)key[0]]);
+        return 1;
+        }
+    lua_pushvalue(L, 2);
+    if(lua_rawget(L, lua_upvalueindex(1)) != LUA_TNIL)
+        return 1;
+    if(!Swizzle(key, len, index, &unique))
+        return 1; /* nil */
+    checkvec(L, 1, v, &size, &isrow);
+    for(i = 0; i < len; i++)
+        {
+        if((size_t)index[i] > size)
+            return luaL_error(L, "invalid swizzle '%s' for a vector of size %d", key, (int)size);
+        w[i] = v[index[i]-1];
+        }
+    return pushvec(L, w, len, len, isrow);
+    }
+
+static int NewIndex(lua_State *L)
+/* __newindex metamethod: v.x = val, v.xy = vec2, ... */
+    {
+    size_t len, size, i;
+    int index[4], unique;
+    const char *key;
+    vec_t w;
+    switch(lua_type(L, 2))
+        {
+        case LUA_TNUMBER: 
+            lua_rawset(L, 1); 
+            return 0;
+        case LUA_TSTRING: 
+            break;
+        default:
+            return luaL_error(L, "cannot write field");
+        }
+    key = lua_tolstring(L, 2, &len);
+    if((len == 1 && Component[(unsigned char)key[0]]))
+        {
+        lua_rawseti(L, 1, Component[(unsigned char)key[0]]);
+        return 0;
+        }
+    if(strcmp(key, "size") == 0 || strcmp(key, "type") == 0)
+        {
+        lua_rawset(L, 1);
+        return 0;
+        }
+    if(!Swizzle(key, len, index, &unique) || !unique)
+        return luaL_error(L, "cannot write field '%s'", key);
+    if(!testvec(L, 3, w, &size, NULL) || size != len)
+        return luaL_error(L, "cannot write field '%s' (vec%d expected)", key, (int)len);
+    for(i = 0; i < len; i++)
+        {
+        lua_pushnumber(L, w[i]);
+        lua_rawseti(L, 1, index[i]);
+        }
+    return 0;
+    }
+
+
+
+/*------------------------------------------------------------------------------*
+ | Shape metatables                                                             |
+ *------------------------------------------------------------------------------*/
+
+/* Each vector shape (vec2, vec3, vec4, vec2r, vec3r, vec4r) has its own metatable, which
+ * is a copy of the VEC_MT one with the arithmetic metamethods replaced by versions that
+ * are specialized for that size. These are closures with the shape metatable as upvalue:
+ * if all the vector operands have it, they can skip the size/type lookups and read the
+ * components directly, otherwise they fall back to the generic metamethods.
+ * (testvec() and friends accept any of them, via their __family field).
+ */
+
+static int SameShape(lua_State *L, int arg)
+    {
+    int ok;
+    if(!lua_getmetatable(L, arg)) return 0;
+    ok = lua_rawequal(L, -1, lua_upvalueindex(1));
+    lua_pop(L, 1);
+    return ok;
+    }
+
+static void ReadVec(lua_State *L, int arg, vec_t v, size_t n)
+    {
+    size_t i;
+    for(i = 0; i < n; i++)
+        {
+        lua_rawgeti(L, arg, i+1);
+        v[i] = luaL_checknumber(L, -1);
+        lua_pop(L, 1);
+        }
+    }
+
+static inline int ShapeUnm(lua_State *L, size_t n, unsigned int isrow)
+    {
+    vec_t v;
+    size_t i;
+    if(!SameShape(L, 1)) return Unm(L);
+    ReadVec(L, 1, v, n);
+    for(i = 0; i < n; i++)
+        v[i] = -v[i];
+    return pushvec(L, v, n, n, isrow);
+    }
+
+static inline int ShapeAdd(lua_State *L, size_t n, unsigned int isrow)
+    {
+    vec_t v, v1;
+    size_t i;
+    if(!SameShape(L, 1) || !SameShape(L, 2)) return Add(L);
+    ReadVec(L, 1, v, n);
+    ReadVec(L, 2, v1, n);
+    for(i = 0; i < n; i++)
+        v[i] += v1[i];
+    return pushvec(L, v, n, n, isrow);
+    }
+
+static inline int ShapeSub(lua_State *L, size_t n, unsigned int isrow)
+    {
+    vec_t v, v1;
+    size_t i;
+    if(!SameShape(L, 1) || !SameShape(L, 2)) return Sub(L);
+    ReadVec(L, 1, v, n);
+    ReadVec(L, 2, v1, n);
+    for(i = 0; i < n; i++)
+        v[i] -= v1[i];
+    return pushvec(L, v, n, n, isrow);
+    }
+
+static inline int ShapeMul(lua_State *L, size_t n, unsigned int isrow)
+/* vec * scalar, scalar * vec, and dot product (same shape) */
+    {
+    vec_t v, v1;
+    size_t i;
+    double s = 0;
+    int sarg = 0, varg = 1;
+    if(lua_type(L, 1) == LUA_TNUMBER) { sarg = 1; varg = 2; }
+    else if(lua_type(L, 2) == LUA_TNUMBER) sarg = 2;
+    if(!SameShape(L, varg) || (!sarg && !SameShape(L, 2))) return Mul(L);
+    ReadVec(L, varg, v, n);
+    if(sarg)
+        {
+        s = lua_tonumber(L, sarg);
+        for(i = 0; i < n; i++)
+            v[i] *= s;
+        return pushvec(L, v, n, n, isrow);
+        }
+    ReadVec(L, 2, v1, n);
+    for(i = 0; i < n; i++) 
+        s += (v[i]*v1[i]);
+    lua_pushnumber(L, s);
+    return 1;
+    }
+
+static inline int ShapeDiv(lua_State *L, size_t n, unsigned int isrow)
+    {
+    vec_t v;
+    size_t i;
+    double s;
+    if(!SameShape(L, 1) || lua_type(L, 2) != LUA_TNUMBER) return Div(L);
+    ReadVec(L, 1, v, n);
+    s = lua_tonumber(L, 2);
+    for(i = 0; i < n; i++)
+        v[i] /= s;
+    return pushvec(L, v, n, n, isrow);
+    }
+
+#define SHAPE_METAMETHODS(S, n, isrow)                                      \
+static int Unm##S(lua_State *L) { return ShapeUnm(L, n, isrow); }           \
+static int Add##S(lua_State *L) { return ShapeAdd(L, n, isrow); }           \
+static int Sub##S(lua_State *L) { return ShapeSub(L, n, isrow); }           \
+static int Mul##S(lua_State *L) { return ShapeMul(L, n, isrow); }           \
+static int Div##S(lua_State *L) { return ShapeDiv(L, n, isrow); }           \
+static const struct luaL_Reg Metamethods##S[] =                             \
+    {                                                                       \
+        { "__unm", Unm##S },                                                \
+        { "__add", Add##S },                                                \
+        { "__sub", Sub##S },                                                \
+        { "__mul", Mul##S },                                                \
+        { "__div", Div##S },                                                \
+        { NULL, NULL } /* sentinel */                                       \
+    };
+
+SHAPE_METAMETHODS(2, 2, 0)
+SHAPE_METAMETHODS(3, 3, 0)
+SHAPE_METAMETHODS(4, 4, 0)
+SHAPE_METAMETHODS(2r, 2, 1)
+SHAPE_METAMETHODS(3r, 3, 1)
+SHAPE_METAMETHODS(4r, 4, 1)
+
+static void NewShape(lua_State *L, const char *name, size_t size, unsigned int isrow, 
+            const struct luaL_Reg *metamethods)
+    {
+    newshapemetatable(L, VEC_MT, name, &ShapeKey[isrow][size]);
+    lua_pushvalue(L, -1);
+    luaL_setfuncs(L, metamethods, 1);
+    lua_pop(L, 1);
+    }
+
 
 static const struct luaL_Reg Metamethods[] = 
     {
@@ -693,6 +992,7 @@ static const struct luaL_Reg Methods[] =
         { "norm", vec_Norm },
         { "norm2", vec_Norm2 },
         { "normalize", vec_Normalize },
+        { "fast_normalize", vec_FastNormalize },
         { "transpose", vec_Transpose },
         { "clamp", vec_Clamp },
         { "mix", vec_Mix },
@@ -726,8 +1026,24 @@ static const struct luaL_Reg Functions[] =
 
 void moonglmath_open_vec(lua_State *L)
     {
+    InitComponents();
     newmetatable(L, VEC_MT);
+    settypetag(L, VEC_MT, TAG_VEC);
     metatable_setfuncs(L, VEC_MT, Metamethods, Methods);
+    /* replace metatable.__index = metatable with the Index() closure */
+    luaL_getmetatable(L, VEC_MT);
+    lua_pushvalue(L, -1);
+    lua_pushcclosure(L, Index, 1);
+    lua_setfield(L, -2, "__index");
+    lua_pushcfunction(L, NewIndex);
+    lua_setfield(L, -2, "__newindex");
+    lua_pop(L, 1);
+    NewShape(L, "moonglmath_vec2", 2, 0, Metamethods2);
+    NewShape(L, "moonglmath_vec3", 3, 0, Metamethods3);
+    NewShape(L, "moonglmath_vec4", 4, 0, Metamethods4);
+    NewShape(L, "moonglmath_vec2r", 2, 1, Metamethods2r);
+    NewShape(L, "moonglmath_vec3r", 3, 1, Metamethods3r);
+    NewShape(L, "moonglmath_vec4r", 4, 1, Metamethods4r);
     luaL_setfuncs(L, Functions, 0);
     }
 
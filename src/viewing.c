@@ -206,6 +206,187 @@ static int Perspective(lua_State *L)
     }
 
 
+/*------------------------------------------------------------------------------*
+ | Projecting and unprojecting points                                           |
+ *------------------------------------------------------------------------------*/
+
+/* The transform is given either as a mat4 (the model-view-projection matrix) or as a
+ * camera (whose cached view-projection matrix and its inverse are used), and the viewport
+ * as a rect { x, y, w, h }. Window coordinates are (x, y, depth), with depth in [0, 1]
+ * between the near and the far plane (as in gluProject/gluUnProject).
+ */
+
+static void CheckTransform(lua_State *L, int arg, mat_t m, int inverse)
+    {
+    size_t nr, nc;
+    mat_t tmp;
+    camera_t *cam = testcamera(L, arg, NULL);
+    if(cam)
+        {
+        if(!camera_matrix(cam, inverse ? CAMERA_INVVIEWPROJ : CAMERA_VIEWPROJ, m))
+            luaL_argerror(L, arg, "singular matrix");
+        return;
+        }
+    if(!testmat(L, arg, tmp, &nr, &nc) || nr != 4 || nc != 4)
+        { luaL_argerror(L, arg, "mat4 or camera expected"); return; }
+    if(!inverse)
+        { mat_copy(m, tmp); return; }
+    if(!mat_inv(m, tmp, 4))
+        luaL_argerror(L, arg, "singular matrix");
+    }
+
+static void CheckViewport(lua_State *L, int arg, rect_t vp)
+    {
+    checkrect(L, arg, vp);
+    if(vp[2] == 0 || vp[3] == 0)
+        luaL_argerror(L, arg, "invalid viewport");
+    }
+
+static void Project(mat_t m, rect_t vp, const double p[3], double w[3])
+/* object coordinates p --> window coordinates w */
+    {
+    int i;
+    double c[4];
+    for(i = 0; i < 4; i++)
+        c[i] = m[i][0]*p[0] + m[i][1]*p[1] + m[i][2]*p[2] + m[i][3];
+    w[0] = vp[0] + vp[2]*(c[0]/c[3] + 1)/2;
+    w[1] = vp[1] + vp[3]*(c[1]/c[3] + 1)/2;
+    w[2] = (c[2]/c[3] + 1)/2;
+    }
+
+static void Unproject(mat_t inv, rect_t vp, const double w[3], double p[3])
+/* window coordinates w --> object coordinates p (inv = inverse of the mvp matrix) */
+    {
+    int i;
+    double n[3], c[4];
+    n[0] = 2*(w[0] - vp[0])/vp[2] - 1;
+    n[1] = 2*(w[1] - vp[1])/vp[3] - 1;
+    n[2] = 2*w[2] - 1;
+    for(i = 0; i < 4; i++)
+        c[i] = inv[i][0]*n[0] + inv[i][1]*n[1] + inv[i][2]*n[2] + inv[i][3];
+    for(i = 0; i < 3; i++)
+        p[i] = c[i]/c[3];
+    }
+
+static void ScreenRay(mat_t inv, rect_t vp, double x, double y, double r[6])
+/* ray through the window point (x, y): r = origin on the near plane, unit direction */
+    {
+    double w[3], f[3], len;
+    w[0] = x; w[1] = y; w[2] = 0;
+    Unproject(inv, vp, w, r);
+    w[2] = 1;
+    Unproject(inv, vp, w, f);
+    r[3] = f[0] - r[0]; r[4] = f[1] - r[1]; r[5] = f[2] - r[2];
+    len = sqrt(r[3]*r[3] + r[4]*r[4] + r[5]*r[5]);
+    if(len > 0)
+        { r[3] /= len; r[4] /= len; r[5] /= len; }
+    }
+
+static int ProjectArray(lua_State *L, int inverse)
+/* project(mvp, viewport, src, dst, [count], [type])
+ * unproject(mvp, viewport, src, dst, [count], [type]) 
+ * src and dst are packed arrays of 3D points, and may be the same hostmem.
+ */
+    {
+    size_t i, k, count;
+    mat_t m;
+    rect_t vp;
+    double a[3], b[3];
+    const char *src;
+    char *dst;
+    int type = checkrealtype(L, 6);
+    size_t sz = 3*sizeoftype(type);
+    CheckTransform(L, 1, m, inverse);
+    CheckViewport(L, 2, vp);
+    dst = checkhostmemarray(L, 4, 5, sz, &count);
+    src = checkhostmemarray(L, 3, 0, sz, &count);
+    for(i = 0; i < count; i++)
+        {
+        for(k = 0; k < 3; k++)
+            a[k] = getreal(src, type, 3*i + k);
+        if(inverse)
+            Unproject(m, vp, a, b);
+        else
+            Project(m, vp, a, b);
+        for(k = 0; k < 3; k++)
+            setreal(dst, type, 3*i + k, b[k]);
+        }
+    return 0;
+    }
+
+static int ProjectPoint(lua_State *L, int inverse)
+    {
+    mat_t m;
+    rect_t vp;
+    vec_t a, b;
+    if(testhostmem(L, 3, NULL))
+        return ProjectArray(L, inverse);
+    CheckTransform(L, 1, m, inverse);
+    CheckViewport(L, 2, vp);
+    checkvec(L, 3, a, NULL, NULL);
+    vec_clear(b);
+    if(inverse)
+        Unproject(m, vp, a, b);
+    else
+        Project(m, vp, a, b);
+    return pushvec(L, b, 3, 3, 0);
+    }
+
+static int ProjectFunc(lua_State *L)
+/* w = project(mvp, viewport, p) */
+    { return ProjectPoint(L, 0); }
+
+static int UnprojectFunc(lua_State *L)
+/* p = unproject(mvp, viewport, w) */
+    { return ProjectPoint(L, 1); }
+
+static int ScreenRays(lua_State *L)
+/* screen_ray(mvp, viewport, coords, dst, [count], [type])
+ * coords is a packed array of window coordinates (x, y), and dst a packed array of rays
+ * (ox, oy, oz, dx, dy, dz) as expected by the raycasting functions.
+ */
+    {
+    size_t i, k, count;
+    mat_t inv;
+    rect_t vp;
+    double r[6];
+    const char *src;
+    char *dst;
+    int type = checkrealtype(L, 6);
+    CheckTransform(L, 1, inv, 1);
+    CheckViewport(L, 2, vp);
+    dst = checkhostmemarray(L, 4, 5, 6*sizeoftype(type), &count);
+    src = checkhostmemarray(L, 3, 0, 2*sizeoftype(type), &count);
+    for(i = 0; i < count; i++)
+        {
+        ScreenRay(inv, vp, getreal(src, type, 2*i), getreal(src, type, 2*i+1), r);
+        for(k = 0; k < 6; k++)
+            setreal(dst, type, 6*i + k, r[k]);
+        }
+    return 0;
+    }
+
+static int ScreenRayFunc(lua_State *L)
+/* origin, direction = screen_ray(mvp, viewport, x, y) */
+    {
+    mat_t inv;
+    rect_t vp;
+    double r[6];
+    vec_t o, d;
+    if(testhostmem(L, 3, NULL))
+        return ScreenRays(L);
+    CheckTransform(L, 1, inv, 1);
+    CheckViewport(L, 2, vp);
+    ScreenRay(inv, vp, luaL_checknumber(L, 3), luaL_checknumber(L, 4), r);
+    vec_clear(o);
+    vec_clear(d);
+    memcpy(o, r, 3*sizeof(double));
+    memcpy(d, r+3, 3*sizeof(double));
+    pushvec(L, o, 3, 3, 0);
+    pushvec(L, d, 3, 3, 0);
+    return 2;
+    }
+
 /*------------------------------------------------------------------------------*
  | Registration                                                                 |
  *------------------------------------------------------------------------------*/
@@ -216,6 +397,9 @@ static const struct luaL_Reg Functions[] =
         { "ortho", Ortho },
         { "frustum", Frustum },
         { "perspective", Perspective },
+        { "project", ProjectFunc },
+        { "unproject", UnprojectFunc },
+        { "screen_ray", ScreenRayFunc },
         { NULL, NULL } /* sentinel */
     };
 